@@ -0,0 +1,189 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "AliasGraph.h"
+#include "TypeDefs.h"
+#include <Udb/Transaction.h>
+#include <Udb/Idx.h>
+#include <Oln2/OutlineItem.h>
+#include <QSet>
+#include <algorithm>
+using namespace Oln;
+
+AliasGraph::AliasGraph(Udb::Transaction* txn, QObject* p):QObject(p),d_txn(txn),
+	d_built(false),d_reverseDirty(true)
+{
+}
+
+void AliasGraph::invalidate()
+{
+	d_built = false;
+	d_target.clear();
+	d_keys.clear();
+	d_start.clear();
+	d_refs.clear();
+}
+
+void AliasGraph::build()
+{
+	if( d_built )
+		return;
+	invalidate();
+	// IdxItemAlias enthält genau die Items mit einem Alias; nur diese werden gelesen
+	Udb::Idx idx( d_txn, OutlineItem::AliasIndex );
+	if( idx.first() ) do
+	{
+		const Udb::OID alias = idx.getOid();
+		const Stream::DataCell v = d_txn->getObject( alias ).getValue( AttrItemAlias );
+		if( v.isOid() && v.getOid() != 0 )
+			d_target[ alias ] = v.getOid();
+	}while( idx.next() );
+	d_built = true;
+	d_reverseDirty = true;
+}
+
+void AliasGraph::addRange(quint64 first, quint64 last)
+{
+	// Nach einem Bulk Load; die Importe erzeugen nur neue Objekte, darum genügt der neue OID-Bereich
+	if( !d_built )
+		return;
+	for( Udb::OID oid = first; oid <= last; oid++ )
+	{
+		const Stream::DataCell v = d_txn->getObject( oid ).getValue( AttrItemAlias );
+		if( v.isOid() && v.getOid() != 0 )
+		{
+			d_target[ oid ] = v.getOid();
+			d_reverseDirty = true;
+		}
+	}
+}
+
+void AliasGraph::buildReverse()
+{
+	build();
+	if( !d_reverseDirty )
+		return;
+	QVector< QPair<Udb::OID,Udb::OID> > edges; // Ziel, Alias
+	edges.reserve( d_target.size() );
+	QHash<Udb::OID,Udb::OID>::const_iterator i;
+	for( i = d_target.begin(); i != d_target.end(); ++i )
+		edges.append( qMakePair( i.value(), i.key() ) );
+	std::sort( edges.begin(), edges.end() );
+	d_keys.clear();
+	d_start.clear();
+	d_refs.resize( edges.size() );
+	for( int j = 0; j < edges.size(); j++ )
+	{
+		if( d_keys.isEmpty() || d_keys.last() != edges[j].first )
+		{
+			d_keys.append( edges[j].first );
+			d_start.append( j );
+		}
+		d_refs[j] = edges[j].second;
+	}
+	d_start.append( edges.size() );
+	d_reverseDirty = false;
+}
+
+int AliasGraph::findTarget(Udb::OID target) const
+{
+	QVector<Udb::OID>::const_iterator i = std::lower_bound( d_keys.begin(), d_keys.end(), target );
+	if( i == d_keys.end() || *i != target )
+		return -1;
+	return i - d_keys.begin();
+}
+
+QList<Udb::OID> AliasGraph::referencedBy(Udb::OID target)
+{
+	buildReverse();
+	QList<Udb::OID> res;
+	const int k = findTarget( target );
+	if( k == -1 )
+		return res;
+	for( quint32 j = d_start[k]; j < d_start[k+1]; j++ )
+		res.append( d_refs[j] );
+	return res;
+}
+
+QList<Udb::OID> AliasGraph::closure(Udb::OID target)
+{
+	// Breitensuche über die CSR-Arrays; visited schützt vor Zyklen aus fehlerhaften Daten
+	buildReverse();
+	QList<Udb::OID> res;
+	QSet<Udb::OID> visited;
+	visited.insert( target );
+	QList<Udb::OID> queue;
+	queue.append( target );
+	while( !queue.isEmpty() )
+	{
+		const int k = findTarget( queue.takeFirst() );
+		if( k == -1 )
+			continue;
+		for( quint32 j = d_start[k]; j < d_start[k+1]; j++ )
+		{
+			const Udb::OID alias = d_refs[j];
+			if( visited.contains( alias ) )
+				continue;
+			visited.insert( alias );
+			res.append( alias );
+			queue.append( alias );
+		}
+	}
+	return res;
+}
+
+QList<Udb::OID> AliasGraph::orphans()
+{
+	// Nur die Ziele sind zu prüfen; die Aliasse selber existieren, sonst wären sie nicht im Graph
+	buildReverse();
+	QList<Udb::OID> res;
+	for( int k = 0; k < d_keys.size(); k++ )
+	{
+		if( d_txn->getObject( d_keys[k] ).isNull() )
+			res.append( d_keys[k] );
+	}
+	return res;
+}
+
+void AliasGraph::onDbUpdate(Udb::UpdateInfo info)
+{
+	if( !d_built )
+		return; // wird beim nächsten Gebrauch ohnehin gelesen
+	switch( info.d_kind )
+	{
+	case Udb::UpdateInfo::ValueChanged:
+		if( info.d_name == AttrItemAlias )
+		{
+			const Stream::DataCell v = d_txn->getObject( info.d_id ).getValue( AttrItemAlias );
+			if( v.isOid() && v.getOid() != 0 )
+				d_target[ info.d_id ] = v.getOid();
+			else
+				d_target.remove( info.d_id );
+			d_reverseDirty = true;
+		}
+		break;
+	case Udb::UpdateInfo::ObjectErased:
+		// Ein gelöschtes Ziel bleibt als Schlüssel referenziert und erscheint in orphans()
+		if( d_target.remove( info.d_id ) )
+			d_reverseDirty = true;
+		break;
+	default:
+		break;
+	}
+}
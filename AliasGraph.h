@@ -0,0 +1,61 @@
+#ifndef ALIASGRAPH_H
+#define ALIASGRAPH_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <Udb/UpdateInfo.h>
+#include <QHash>
+#include <QVector>
+
+namespace Oln
+{
+	// Alle AttrItemAlias-Beziehungen einer Datenbank im Speicher. Vorwärts als Hash (Alias -> Ziel),
+	// rückwärts CSR-artig als sortierte Ziele mit Offsets in ein Array der Aliasse. Wird beim Öffnen
+	// des Repository aus IdxItemAlias aufgebaut und über Notifications nachgeführt; die Rückwärts-Sicht
+	// erst bei Bedarf.
+	class AliasGraph : public QObject
+	{
+		Q_OBJECT
+	public:
+		AliasGraph( Udb::Transaction*, QObject* );
+		void build(); // beim Öffnen des Repository; danach nur noch Deltas
+		QList<Udb::OID> referencedBy( Udb::OID target ); // direkte Aliasse von target
+		QList<Udb::OID> closure( Udb::OID target ); // auch Aliasse von Aliassen, ohne target
+		QList<Udb::OID> orphans(); // referenzierte Ziele, die nicht mehr existieren
+	public slots:
+		void invalidate();
+		void addRange( quint64 first, quint64 last ); // neu erzeugte OIDs, siehe Repository::sigBulkInserted
+	protected slots:
+		void onDbUpdate( Udb::UpdateInfo );
+	private:
+		void buildReverse();
+		int findTarget( Udb::OID ) const;
+		Udb::Transaction* d_txn;
+		QHash<Udb::OID,Udb::OID> d_target;
+		QVector<Udb::OID> d_keys; // sortierte Ziele
+		QVector<quint32> d_start; // d_keys.size() + 1 Einträge
+		QVector<Udb::OID> d_refs;
+		bool d_built;
+		bool d_reverseDirty;
+	};
+}
+
+#endif // ALIASGRAPH_H
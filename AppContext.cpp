@@ -29,6 +29,8 @@
 #include <QLabel>
 #include <QDesktopServices>
 #include <QVBoxLayout>
+#include <QElapsedTimer>
+#include <QtDebug>
 #include <QtGui/private/qtextdocument_p.h>
 #ifdef _HAS_LUA_
 #include <Qtl2/Objects.h>
@@ -44,6 +46,9 @@ using namespace Oln;
 using namespace Udb;
 
 static AppContext* s_inst;
+static QElapsedTimer s_phaseTimer;
+static qint64 s_lastPhase = 0;
+static QString s_phaseWhat;
 const char* AppContext::s_company = "Dr. Rochus Keller";
 const char* AppContext::s_domain = "me@rochus-keller.ch";
 const char* AppContext::s_appName = "CrossLine";
@@ -198,23 +203,28 @@ bool AppContext::open(QString cmdLine)
         }
     }
 
+    startPhases( path );
     Repository* r = new Repository( this );
     if( !r->open( path  ) )
     {
+        endPhases();
         delete r;
         // Wir können das Repository nicht öffnen.
         // Gib false zurück, wenn ansonsten kein Outline offen ist, damit Anwendung enden kann.
         return d_outliner.isEmpty();
     }
 	Outliner* o = new Outliner( r );
+    phase( "Outliner" );
     connect( o, SIGNAL(closing()), this, SLOT(onCloseOutliner()) );
     o->showOid( oid );
+    phase( "showOid" );
 	o->activateWindow();
 	o->raise();
 #ifndef _WIN32
 	_SplashDialog dlg(o);
 #endif
     d_outliner.append( o );
+    endPhases();
     return true;
 }
 
@@ -249,6 +259,30 @@ AppContext* AppContext::inst()
 	return s_inst;
 }
 
+void AppContext::startPhases(const QString& what)
+{
+	s_phaseWhat = what;
+	s_lastPhase = 0;
+	s_phaseTimer.start();
+}
+
+void AppContext::phase(const char* name)
+{
+	if( !s_phaseTimer.isValid() )
+		return;
+	const qint64 now = s_phaseTimer.elapsed();
+	qDebug() << "startup phase" << name << ( now - s_lastPhase ) << "ms, total" << now << "ms";
+	s_lastPhase = now;
+}
+
+void AppContext::endPhases()
+{
+	if( !s_phaseTimer.isValid() )
+		return;
+	qDebug() << "startup of" << s_phaseWhat << "took" << s_phaseTimer.elapsed() << "ms";
+	s_phaseTimer.invalidate();
+}
+
 void AppContext::onHandleXoid(const QUrl & url)
 {
     const QString oid = url.userInfo();
@@ -50,7 +50,12 @@ namespace Oln
 
         bool open( QString path );
 		static AppContext* inst();
+		// Einfacher Profiler für den Start; schreibt die Dauer der Phasen ins Log
+		static void startPhases( const QString& what );
+		static void phase( const char* name );
+		static void endPhases();
 		QSettings* getSet() const { return d_set; }
+		const QList<Outliner*>& getOutliners() const { return d_outliner; }
 		void setDocFont( const QFont& );
     public slots:
         void onOpen( const QString& path );
@@ -0,0 +1,322 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Archiver.h"
+#include "Repository.h"
+#include "AliasGraph.h"
+#include "AppContext.h"
+#include "Outliner.h"
+#include "TypeDefs.h"
+#include <Oln2/OutlineUdbStream.h>
+#include <Udb/Transaction.h>
+#include <Udb/Database.h>
+#include <Udb/Idx.h>
+#include <Udb/Qit.h>
+#include <Udb/DatabaseException.h>
+#include <Stream/DataWriter.h>
+#include <Stream/DataReader.h>
+#include <QProgressDialog>
+#include <QApplication>
+#include <QSettings>
+#include <QFileInfo>
+#include <QBuffer>
+#include <QDir>
+#include <QStack>
+#include <QHash>
+#include <QDateTime>
+using namespace Oln;
+
+Archiver::Archiver(Repository* doc):d_doc(doc),d_archive(0),d_ownArchive(false),d_skipped(0)
+{
+	Q_ASSERT( doc != 0 );
+}
+
+Archiver::~Archiver()
+{
+	if( d_ownArchive )
+		delete d_archive;
+}
+
+QString Archiver::defaultPath(const QString& repoPath)
+{
+	QFileInfo info( repoPath );
+	return info.absoluteDir().absoluteFilePath( info.completeBaseName() + QLatin1String( "-archive" ) +
+												QLatin1String( AppContext::s_extension ) );
+}
+
+QString Archiver::getArchivePath() const
+{
+	// Einmal festgelegt, bleibt das Archiv beim Repository
+	const QString path = d_doc->getRoot().getString( AttrRootArchive );
+	if( !path.isEmpty() )
+		return path;
+	const QString set = AppContext::inst()->getSet()->value( "Archive/Path" ).toString();
+	if( !set.isEmpty() )
+		return set;
+	return defaultPath( d_doc->getDb()->getFilePath() );
+}
+
+bool Archiver::isArchived(const Udb::Obj& o)
+{
+	return !o.isNull() && o.getType() == TypeOutline && o.getValue( AttrArchivedAs ).getOid() != 0;
+}
+
+QList<Udb::Obj> Archiver::findCandidates(const QDateTime& cutoff, const QSet<Udb::OID>& exclude) const
+{
+	QList<Udb::Obj> res;
+	const Udb::OID autoOpen = d_doc->getRoot().getValue( AttrAutoOpen ).getOid();
+	Udb::Qit q = d_doc->getRoot().getFirstSlot();
+	if( !q.isNull() ) do
+	{
+		Udb::Obj oln = d_doc->getTxn()->getObject( q.getValue().getOid() );
+		if( oln.isNull() || oln.getType() != TypeOutline || isArchived( oln ) ||
+				exclude.contains( oln.getOid() ) || oln.getOid() == autoOpen )
+			continue;
+		const Stream::DataCell valuta = oln.getValue( AttrValuta );
+		if( valuta.isDateTime() && valuta.getDateTime() < cutoff )
+			res.append( oln );
+	}while( q.next() );
+	return res;
+}
+
+static void _collect( const Udb::Obj& oln, QList<Udb::Obj>& items )
+{
+	// Preorder; im Archiv entsteht dieselbe Reihenfolge, darum dienen die Positionen als OID-Abbildung
+	QStack<Udb::Obj> stack;
+	Udb::Obj sub = oln.getFirstObj();
+	if( !sub.isNull() )
+		stack.push( sub );
+	while( !stack.isEmpty() )
+	{
+		const Udb::Obj o = stack.pop();
+		items.append( o );
+		Udb::Obj next = o;
+		if( next.next() )
+			stack.push( next );
+		Udb::Obj first = o.getFirstObj();
+		if( !first.isNull() )
+			stack.push( first );
+	}
+}
+
+bool Archiver::isSelfContained(const Udb::Obj& oln, const QList<Udb::Obj>& items, AliasGraph* graph)
+{
+	// Aliasse dürfen die Grenze des Outlines nicht überqueren, sonst zeigten sie danach ins Leere.
+	// Aliasse auf das Outline selber bleiben gültig, da der Stub im Repository bleibt.
+	QSet<Udb::OID> inside;
+	inside.insert( oln.getOid() );
+	foreach( const Udb::Obj& o, items )
+		inside.insert( o.getOid() );
+	foreach( const Udb::Obj& o, items )
+	{
+		const Udb::OID alias = o.getValue( AttrItemAlias ).getOid();
+		if( alias != 0 && !inside.contains( alias ) )
+			return false;
+		foreach( Udb::OID ref, graph->referencedBy( o.getOid() ) )
+			if( !inside.contains( ref ) )
+				return false;
+	}
+	return true;
+}
+
+Repository* Archiver::openArchive(const QString& path)
+{
+	// Ist das Archiv bereits in einem Fenster offen, dessen Repository mitbenutzen; eine zweite
+	// Transaction auf dieselbe Datei würde an den commits des Fensters scheitern.
+	const QString canonical = QFileInfo( path ).canonicalFilePath();
+	if( !canonical.isEmpty() )
+	{
+		foreach( Outliner* o, AppContext::inst()->getOutliners() )
+		{
+			if( QFileInfo( o->getDoc()->getDb()->getFilePath() ).canonicalFilePath() == canonical )
+				return o->getDoc();
+		}
+	}
+	// Gehört dem Archiver und wird in ~Archiver gelöscht (d_ownArchive)
+	Repository* r = new Repository();
+	if( !r->open( path ) )
+	{
+		delete r;
+		return 0;
+	}
+	d_ownArchive = true;
+	return r;
+}
+
+int Archiver::run(const QList<Udb::Obj>& olns, QWidget* parent)
+{
+	const QString path = getArchivePath();
+	if( d_archive == 0 )
+		d_archive = openArchive( path );
+	if( d_archive == 0 )
+	{
+		d_error = tr("cannot open archive '%1'").arg( path );
+		return -1;
+	}
+	if( d_archive == d_doc )
+	{
+		d_error = tr("the archive '%1' is the repository itself").arg( path );
+		return -1;
+	}
+	d_doc->getRoot().setValue( AttrRootArchive, Stream::DataCell().setString( d_archive->getDb()->getFilePath() ) );
+	d_doc->getTxn()->commit();
+
+	QProgressDialog progress( tr("Archiving outlines..."), tr("Abort"), 0, olns.size(), parent );
+	progress.setWindowTitle( tr( "CrossLine" ) );
+	progress.setWindowModality(Qt::WindowModal);
+	AliasGraph* graph = d_doc->getAliasGraph();
+	int done = 0;
+	d_skipped = 0;
+	for( int i = 0; i < olns.size(); i++ )
+	{
+		progress.setValue( i );
+		QApplication::processEvents();
+		if( progress.wasCanceled() )
+			break;
+		QList<Udb::Obj> items;
+		_collect( olns[i], items );
+		if( !isSelfContained( olns[i], items, graph ) )
+		{
+			d_skipped++;
+			continue;
+		}
+		if( archiveOutline( olns[i], items ) )
+			done++;
+		else
+			d_skipped++;
+	}
+	progress.setValue( olns.size() );
+	return done;
+}
+
+bool Archiver::archiveOutline(const Udb::Obj& oln, const QList<Udb::Obj>& items)
+{
+	QBuffer buf;
+	buf.open( QIODevice::ReadWrite );
+	Stream::DataWriter w( &buf );
+	OutlineUdbStream::writeOutline( w, oln );
+	buf.seek( 0 );
+
+	// Zuerst das Archiv committen; scheitert danach das Repository, gibt es höchstens eine
+	// überzählige Kopie im Archiv, aber nie einen Verlust.
+	Udb::Transaction* atxn = d_archive->getTxn();
+	Udb::Obj aoln = atxn->createObject( TypeOutline );
+	Stream::DataReader r( &buf );
+	const QByteArray res = OutlineUdbStream::readOutline( r, aoln );
+	QList<Udb::Obj> copies;
+	_collect( aoln, copies );
+	if( !res.isEmpty() || copies.size() != items.size() )
+	{
+		d_archive->rollback();
+		d_error = ( res.isEmpty() ) ? tr("item count mismatch") : QString::fromLatin1( res );
+		return false;
+	}
+	const quint32 attrs[] = { AttrText, AttrIdent, AttrSummary, AttrCreatedOn, AttrModifiedOn, AttrValuta };
+	for( int a = 0; a < int( sizeof(attrs) / sizeof(attrs[0]) ); a++ )
+		aoln.setValue( attrs[a], oln.getValue( attrs[a] ) );
+	aoln.setValue( AttrArchivedFrom, Stream::DataCell().setOid( oln.getOid() ) );
+	QHash<Udb::OID,Udb::OID> map;
+	map[oln.getOid()] = aoln.getOid();
+	for( int k = 0; k < items.size(); k++ )
+		map[items[k].getOid()] = copies[k].getOid();
+	for( int k = 0; k < items.size(); k++ )
+	{
+		copies[k].setValue( AttrArchivedFrom, Stream::DataCell().setOid( items[k].getOid() ) );
+		// Aliasse innerhalb des Outlines auf die neuen OIDs umhängen
+		const Udb::OID alias = items[k].getValue( AttrItemAlias ).getOid();
+		if( alias != 0 )
+			copies[k].setValue( AttrItemAlias, Stream::DataCell().setOid( map.value( alias ) ) );
+	}
+	d_archive->getRoot().appendSlot( aoln );
+	atxn->commit();
+
+	// Im Repository nur den Stub behalten; er bleibt an seinem Platz in der History
+	Udb::Obj sub = oln.getFirstObj();
+	while( !sub.isNull() )
+	{
+		Udb::Obj next = sub;
+		if( !next.next() )
+			next = Udb::Obj();
+		sub.erase();
+		sub = next;
+	}
+	oln.setValue( AttrArchivedAs, Stream::DataCell().setOid( aoln.getOid() ) );
+	oln.setValue( AttrItemIsReadOnly, Stream::DataCell().setBool( true ) );
+	d_doc->getTxn()->commit();
+	return true;
+}
+
+void Archiver::rollback()
+{
+	if( d_archive )
+		d_archive->rollback();
+	d_doc->rollback();
+}
+
+static QHash<QString,RepoSnapshot*> s_archives; // Pfad -> offener Snapshot für locate()
+
+static void _closeArchives()
+{
+	qDeleteAll( s_archives );
+	s_archives.clear();
+}
+
+bool Archiver::locate(Repository* doc, Udb::OID oid, QString& path, Udb::OID& archived)
+{
+	path = doc->getRoot().getString( AttrRootArchive );
+	if( path.isEmpty() || oid == 0 )
+		return false;
+	Udb::Obj o = doc->getTxn()->getObject( oid );
+	if( isArchived( o ) )
+	{
+		archived = o.getValue( AttrArchivedAs ).getOid();
+		return true;
+	}
+	if( !o.isNull() )
+		return false;
+	// Ein ausgelagertes Item; OIDs werden im Repository nie wiederverwendet
+	RepoSnapshot* snap = s_archives.value( path );
+	if( snap == 0 )
+	{
+		snap = Repository::openSnapshot( path );
+		if( snap == 0 )
+			return false;
+		if( s_archives.isEmpty() )
+			qAddPostRoutine( _closeArchives );
+		s_archives[path] = snap;
+	}
+	archived = 0;
+	for( int attempt = 0; ; attempt++ )
+	{
+		// Seit dem letzten Aufruf können weitere Outlines ins Archiv gekommen sein
+		snap->refresh();
+		try
+		{
+			Udb::Idx idx( snap->getTxn(), IndexDefs::IdxArchivedFrom );
+			if( idx.seek( Stream::DataCell().setOid( oid ) ) )
+				archived = idx.getOid();
+			break;
+		}catch( Udb::DatabaseException& e )
+		{
+			if( !snap->retryAfterBusy( e, attempt ) )
+				return false;
+		}
+	}
+	return archived != 0;
+}
@@ -0,0 +1,65 @@
+#ifndef ARCHIVER_H
+#define ARCHIVER_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <QCoreApplication>
+#include <QSet>
+
+class QWidget;
+
+namespace Oln
+{
+	class Repository;
+	class AliasGraph;
+
+	// Verschiebt alte Outlines in ein zweites Repository. Im Repository bleibt das Outline-Objekt als
+	// leerer, schreibgeschützter Stub in der History; Links auf das Outline und auf seine Items
+	// werden über AttrArchivedAs bzw. IdxArchivedFrom ins Archiv umgeleitet.
+	class Archiver
+	{
+		Q_DECLARE_TR_FUNCTIONS(Archiver)
+	public:
+		Archiver( Repository* );
+		~Archiver();
+		static QString defaultPath( const QString& repoPath );
+		QString getArchivePath() const;
+		QList<Udb::Obj> findCandidates( const QDateTime& cutoff, const QSet<Udb::OID>& exclude ) const;
+		int run( const QList<Udb::Obj>&, QWidget* ); // Anzahl ausgelagerter Outlines, -1 falls kein Archiv
+		void rollback(); // nach einer DatabaseException aus run(), beide Transaktionen
+		int getSkipped() const { return d_skipped; }
+		const QString& getError() const { return d_error; }
+		static bool isArchived( const Udb::Obj& );
+		// Sucht oid im Archiv, sei es ein Stub oder ein nicht mehr vorhandenes Item; false falls unbekannt
+		static bool locate( Repository*, Udb::OID oid, QString& path, Udb::OID& archived );
+	private:
+		Repository* openArchive( const QString& path );
+		bool isSelfContained( const Udb::Obj& oln, const QList<Udb::Obj>& items, AliasGraph* );
+		bool archiveOutline( const Udb::Obj& oln, const QList<Udb::Obj>& items );
+		Repository* d_doc;
+		Repository* d_archive;
+		bool d_ownArchive;
+		int d_skipped;
+		QString d_error;
+	};
+}
+
+#endif // ARCHIVER_H
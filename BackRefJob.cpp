@@ -0,0 +1,198 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "BackRefJob.h"
+#include "TypeDefs.h"
+#include "AppContext.h"
+#include "Repository.h"
+#include <Udb/Transaction.h>
+#include <Udb/Database.h>
+#include <Udb/Mit.h>
+#include <Oln2/OutlineItem.h>
+#include <QProgressDialog>
+#include <QApplication>
+#include <QSettings>
+using namespace Oln;
+
+const char* BackRefJob::s_pendingUuid = "{6C1A3F52-7E0B-4D8A-9B31-2F4E5A6D7C80}";
+
+BackRefJob::BackRefJob( Repository* doc, QObject* p ):QObject(p),d_updated(0),d_running(false)
+{
+	Udb::Transaction* txn = doc->getTxn();
+	QUuid uuid = s_pendingUuid;
+	if( txn->getDb()->isReadOnly() )
+		d_pending = txn->getObject( uuid );
+	else
+	{
+		d_pending = txn->getOrCreateObject( uuid );
+		txn->commit();
+	}
+	// Über Repository, damit ein Import nicht jedes Item einzeln ins Journal schreibt
+	doc->addObserver( this, SLOT(onDbUpdate( Udb::UpdateInfo ) ), true );
+	connect( doc, SIGNAL(sigBulkInserted(quint64,quint64)), this, SLOT(onBulkInserted(quint64,quint64)) );
+}
+
+static void _collect( const Udb::Obj& pending, QList<Udb::OID>& todo )
+{
+	// Einzelne Items als [oid], importierte Bereiche als [first,last]
+	Udb::Mit mit = pending.findCells( Udb::Obj::KeyList() );
+	if( !mit.isNull() ) do
+	{
+		Udb::Mit::KeyList k = mit.getKey();
+		if( k.size() == 1 && k[0].isOid() )
+			todo.append( k[0].getOid() );
+		else if( k.size() == 2 && k[0].isOid() && k[1].isOid() )
+		{
+			for( Udb::OID oid = k[0].getOid(); oid <= k[1].getOid(); oid++ )
+				todo.append( oid );
+		}
+	}while( mit.nextKey() );
+}
+
+int BackRefJob::getPendingCount() const
+{
+	int res = 0;
+	if( d_pending.isNull() )
+		return res;
+	Udb::Mit i = d_pending.findCells( Udb::Obj::KeyList() );
+	if( !i.isNull() ) do
+	{
+		Udb::Mit::KeyList k = i.getKey();
+		if( k.size() == 1 && k[0].isOid() )
+			res++;
+		else if( k.size() == 2 && k[0].isOid() && k[1].isOid() )
+			res += int( k[1].getOid() - k[0].getOid() + 1 );
+	}while( i.nextKey() );
+	return res;
+}
+
+void BackRefJob::onDbUpdate( Udb::UpdateInfo info )
+{
+	if( info.d_kind != Udb::UpdateInfo::PreCommit || d_running || d_pending.isNull() )
+		return;
+	// Kopie, da setCell die Notification List ergänzt
+	QList<Udb::UpdateInfo> updates = d_pending.getTxn()->getPendingNotifications();
+	Udb::Obj::KeyList k(1);
+	for( int i = 0; i < updates.size(); i++ )
+	{
+		const Udb::UpdateInfo& upd = updates[i];
+		if( upd.d_kind == Udb::UpdateInfo::ValueChanged && upd.d_name == AttrText )
+		{
+			k[0].setOid( upd.d_id );
+			if( d_pending.getCell( k ).isNull() )
+				d_pending.setCell( k, Stream::DataCell().setBool( true ) );
+			// NOTE: kein commit, da in Pre-Commit der Transaction, wo die Änderung stattfand
+		}
+	}
+}
+
+void BackRefJob::onBulkInserted( quint64 first, quint64 last )
+{
+	if( d_pending.isNull() )
+		return;
+	// Ein Eintrag für den ganzen Import; run() prüft die Typen
+	Udb::Obj::KeyList k(2);
+	k[0].setOid( first );
+	k[1].setOid( last );
+	d_pending.setCell( k, Stream::DataCell().setBool( true ) );
+	d_pending.commit();
+}
+
+void BackRefJob::updateItem( Udb::Obj& o )
+{
+	// Die Links im Text können seit dem letzten Update dazugekommen oder weggefallen sein
+	if( o.getType() != TypeOutlineItem )
+		return;
+	OutlineItem::updateRefs( o );
+	d_updated++;
+}
+
+bool BackRefJob::run( QWidget* parent )
+{
+	if( d_pending.isNull() )
+		return true;
+	Udb::Transaction* txn = d_pending.getTxn();
+	QList<Udb::OID> todo;
+	_collect( d_pending, todo );
+	qSort( todo ); // in Schlüsselreihenfolge lesen
+	// Bereiche erst am Schluss löschen; bis dahin bleiben sie bei einem Abbruch vollständig pendent
+	QList<Udb::Mit::KeyList> ranges;
+	Udb::Mit mit = d_pending.findCells( Udb::Obj::KeyList() );
+	if( !mit.isNull() ) do
+	{
+		if( mit.getKey().size() == 2 )
+			ranges.append( mit.getKey() );
+	}while( mit.nextKey() );
+
+	const int chunk = qMax( 1, AppContext::inst()->getSet()->value( "BackRefs/ChunkSize", 500 ).toInt() );
+	QProgressDialog progress( tr("Updating back references..."), tr("Abort"), 0, todo.size(), parent );
+	progress.setWindowTitle( tr( "CrossLine" ) );
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setAutoClose( true );
+
+	d_running = true;
+	d_updated = 0;
+	Udb::Obj::KeyList k(1);
+	bool ok = true;
+	for( int i = 0; i < todo.size(); i++ )
+	{
+		Udb::Obj o = txn->getObject( todo[i] );
+		if( !o.isNull() )
+			updateItem( o );
+		k[0].setOid( todo[i] );
+		d_pending.setCell( k, Stream::DataCell().setNull() );
+		if( ( i + 1 ) % chunk == 0 )
+		{
+			// Was bis hier geprüft ist, bleibt auch bei Abbruch geprüft
+			txn->commit();
+			progress.setValue( i + 1 );
+			if( progress.wasCanceled() )
+			{
+				ok = false;
+				break;
+			}
+		}
+	}
+	if( ok )
+	{
+		foreach( const Udb::Mit::KeyList& r, ranges )
+			d_pending.setCell( r, Stream::DataCell().setNull() );
+	}
+	txn->commit();
+	progress.setValue( todo.size() );
+	d_running = false;
+	return ok;
+}
+
+void BackRefJob::clear()
+{
+	if( d_pending.isNull() )
+		return;
+	d_running = true;
+	Udb::Mit mit = d_pending.findCells( Udb::Obj::KeyList() );
+	QList<Udb::Mit::KeyList> keys;
+	if( !mit.isNull() ) do
+	{
+		keys.append( mit.getKey() );
+	}while( mit.nextKey() );
+	foreach( const Udb::Mit::KeyList& k, keys )
+		d_pending.setCell( k, Stream::DataCell().setNull() );
+	d_pending.commit();
+	d_running = false;
+}
@@ -0,0 +1,56 @@
+#ifndef BACKREFJOB_H
+#define BACKREFJOB_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <Udb/UpdateInfo.h>
+
+class QWidget;
+
+namespace Oln
+{
+	class Repository;
+
+	// Führt ein persistentes Journal der Items, deren AttrText seit dem letzten Update geändert hat,
+	// und baut nur deren Rückverweise neu auf, wie es OutlineItem::updateAllRefs für alle Items tut.
+	// IdxItemAlias braucht das nicht; den führt Udb bei jedem setValue selber nach.
+	class BackRefJob : public QObject
+	{
+		Q_OBJECT
+	public:
+		static const char* s_pendingUuid;
+		BackRefJob( Repository*, QObject* );
+		int getPendingCount() const;
+		bool run( QWidget* ); // Blocking, aber in Etappen committed und abbrechbar
+		void clear(); // nach einem vollständigen Rebuild
+		int getUpdated() const { return d_updated; }
+	protected slots:
+		void onDbUpdate( Udb::UpdateInfo );
+		void onBulkInserted( quint64 first, quint64 last );
+	private:
+		void updateItem( Udb::Obj& );
+		Udb::Obj d_pending;
+		int d_updated;
+		bool d_running;
+	};
+}
+
+#endif // BACKREFJOB_H
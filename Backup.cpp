@@ -0,0 +1,214 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "Backup.h"
+#include "AppContext.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+using namespace Oln;
+
+static const int s_block = 64 * 1024; // Vielfaches jeder Sqlite Page Size
+static const int s_maxAttempts = 50;
+static const int s_waitMs = 20;
+
+Backup::Backup(const QString& path, const QString& dir, QObject* p):
+	QThread(p),d_path(path),d_result(Running),d_done(0),d_total(0)
+{
+	QFileInfo info( path );
+	d_target = QDir( dir ).absoluteFilePath( info.completeBaseName() +
+		QDateTime::currentDateTime().toString( "-yyyyMMdd-hhmmss" ) + QLatin1String( AppContext::s_extension ) );
+}
+
+QString Backup::defaultDir(const QString& path)
+{
+	return QFileInfo( path ).absoluteDir().absoluteFilePath( QLatin1String( "Backups" ) );
+}
+
+int Backup::rotate(const QString& path, const QString& dir, int keep)
+{
+	if( keep <= 0 )
+		return 0;
+	// Der Zeitstempel im Namen sortiert chronologisch
+	const QStringList files = QDir( dir ).entryList( QStringList() << QFileInfo( path ).completeBaseName() +
+		QLatin1String( "-*" ) + QLatin1String( AppContext::s_extension ), QDir::Files, QDir::Name );
+	int n = 0;
+	for( int i = 0; i < files.size() - keep; i++ )
+	{
+		const QString f = QDir( dir ).absoluteFilePath( files[i] );
+		QFile::remove( f + QLatin1String( ".index" ) );
+		if( QFile::remove( f ) )
+			n++;
+	}
+	return n;
+}
+
+int Backup::copyPass(QFile& from, QFile& to, bool compare)
+{
+	if( !from.seek( 0 ) || !to.seek( 0 ) )
+		return -1;
+	qint64 pos = 0;
+	int changed = 0;
+	while( true )
+	{
+		if( int( d_cancel ) )
+			return -1;
+		const QByteArray src = from.read( s_block );
+		if( src.isEmpty() )
+			break;
+		// Beim Vergleich nur die geänderten Blöcke neu schreiben
+		if( !compare || to.read( src.size() ) != src )
+		{
+			if( !to.seek( pos ) || to.write( src ) != src.size() )
+				return -1;
+			changed++;
+		}
+		pos += src.size();
+		if( !compare )
+		{
+			d_done += src.size();
+			emit sigProgress( int( d_done / 1024 ), int( qMax( d_total, d_done ) / 1024 ) );
+		}
+	}
+	if( to.size() != pos )
+	{
+		if( !to.resize( pos ) )
+			return -1;
+		changed++;
+	}
+	if( !to.seek( pos ) )
+		return -1;
+	return changed;
+}
+
+static bool _journalActive( const QString& path )
+{
+	// Sqlite schreibt das Journal, bevor es die Datei ändert, und leert oder löscht es nach dem commit
+	const QFileInfo info( path + QLatin1String( "-journal" ) );
+	return info.exists() && info.size() > 0;
+}
+
+bool Backup::openFiles(const QString& path, const QString& to, QFile& from, QFile& out, bool truncate)
+{
+	from.setFileName( path );
+	out.setFileName( to );
+	if( !from.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) ||
+			!out.open( QIODevice::ReadWrite | QIODevice::Unbuffered | ( ( truncate ) ? QIODevice::Truncate : QIODevice::NotOpen ) ) )
+	{
+		d_error = tr("cannot copy '%1' to '%2'").arg( path ).arg( to );
+		d_result = Failed;
+		return false;
+	}
+	return true;
+}
+
+bool Backup::settle(const QString& path, QFile& from, QFile& out)
+{
+	// Vergleichen, bis zwei Durchgänge hintereinander keinen Unterschied finden und vor dem ersten und
+	// nach dem zweiten kein commit im Gang ist (kein nicht-leeres Journal). Das ist eine Heuristik ohne
+	// Sqlite-Lock: ein commit, der zwischen den Durchgängen ganz abläuft, fällt erst im nächsten
+	// Vergleich auf und setzt die Zählung zurück.
+	int clean = 0;
+	for( int i = 0; i < s_maxAttempts; i++ )
+	{
+		if( _journalActive( path ) )
+		{
+			clean = 0;
+			msleep( s_waitMs );
+			continue;
+		}
+		const int changed = copyPass( from, out, true );
+		if( changed < 0 )
+		{
+			d_result = ( int( d_cancel ) ) ? Canceled : Failed;
+			return false;
+		}
+		if( changed == 0 )
+		{
+			if( ++clean == 2 )
+			{
+				if( !_journalActive( path ) )
+					return true;
+				clean = 0;
+			}
+		}else
+		{
+			clean = 0;
+			msleep( s_waitMs );
+		}
+	}
+	d_result = Busy;
+	return false;
+}
+
+bool Backup::copyFile(const QString& path, const QString& to)
+{
+	QFile from;
+	QFile out;
+	if( !openFiles( path, to, from, out, true ) )
+		return false;
+	// Der erste Durchgang kopiert alles, auch wenn dabei committed wird
+	if( copyPass( from, out, false ) < 0 )
+	{
+		d_result = ( int( d_cancel ) ) ? Canceled : Failed;
+		return false;
+	}
+	return settle( path, from, out );
+}
+
+bool Backup::verifyFile(const QString& path, const QString& to)
+{
+	QFile from;
+	QFile out;
+	if( !openFiles( path, to, from, out, false ) )
+		return false;
+	return settle( path, from, out );
+}
+
+void Backup::run()
+{
+	const QString index = d_path + QLatin1String( ".index" ); // siehe SearchView2::getIndexPath
+	const bool hasIndex = QFileInfo( index ).exists();
+	d_total = QFileInfo( d_path ).size() + ( ( hasIndex ) ? QFileInfo( index ).size() : 0 );
+	QDir().mkpath( QFileInfo( d_target ).absolutePath() );
+	const QString part = QLatin1String( ".part" );
+	// Der .index erst, wenn das Repository stimmt; danach das Repository nochmals prüfen, weil während
+	// der Kopie des Index weiter committed werden konnte.
+	if( !copyFile( d_path, d_target + part ) ||
+			( hasIndex && !copyFile( index, d_target + QLatin1String( ".index" ) + part ) ) ||
+			( hasIndex && !verifyFile( d_path, d_target + part ) ) )
+	{
+		QFile::remove( d_target + part );
+		QFile::remove( d_target + QLatin1String( ".index" ) + part );
+		if( d_error.isEmpty() && int( d_result ) == Busy )
+			d_error = tr("repository was modified continuously during the copy");
+		return;
+	}
+	// Erst jetzt umbenennen, damit eine abgebrochene Kopie nie wie ein gültiges Backup aussieht
+	if( !QFile::rename( d_target + part, d_target ) ||
+			( hasIndex && !QFile::rename( d_target + QLatin1String( ".index" ) + part,
+										  d_target + QLatin1String( ".index" ) ) ) )
+	{
+		d_error = tr("cannot rename '%1'").arg( d_target + part );
+		d_result = Failed;
+		return;
+	}
+	d_result = Ok;
+}
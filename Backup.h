@@ -0,0 +1,66 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+
+class QFile;
+
+namespace Oln
+{
+	// Kopiert die Repository-Datei und ihren .index im Hintergrund, während weiter editiert wird.
+	// Nach der ersten Kopie werden nur noch die Blöcke neu geschrieben, die sich inzwischen geändert
+	// haben, bis zwei Vergleiche hintereinander keinen Unterschied mehr finden und kein Journal offen ist.
+	class Backup : public QThread
+	{
+		Q_OBJECT
+	public:
+		enum Result { Running, Ok, Busy, Failed, Canceled };
+		Backup( const QString& path, const QString& dir, QObject* );
+		static QString defaultDir( const QString& path );
+		static int rotate( const QString& path, const QString& dir, int keep ); // Anzahl gelöschter Kopien
+		void cancel() { d_cancel = 1; }
+		int getResult() const { return int( d_result ); } // aus dem GUI Thread, auch während run()
+		const QString& getTarget() const { return d_target; }
+		const QString& getError() const { return d_error; }
+	signals:
+		void sigProgress( int doneKb, int totalKb );
+	protected:
+		void run();
+		bool copyFile( const QString& from, const QString& to );
+		bool verifyFile( const QString& from, const QString& to ); // eine fertige Kopie nachführen
+		bool openFiles( const QString& path, const QString& to, QFile& from, QFile& out, bool truncate );
+		bool settle( const QString& path, QFile& from, QFile& out );
+		int copyPass( QFile& from, QFile& to, bool compare ); // Anzahl neu geschriebener Blöcke, -1 bei Fehler
+	private:
+		QString d_path;
+		QString d_target;
+		QString d_error;
+		QAtomicInt d_cancel;
+		QAtomicInt d_result;
+		qint64 d_done;
+		qint64 d_total;
+	};
+}
+
+#endif // BACKUP_H
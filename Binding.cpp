@@ -86,7 +86,7 @@ struct _View
 	static int rollback(lua_State *L)
 	{
 		Outliner* oln = Lua::QtObject<Outliner>::check( L, 1 );
-		oln->getDoc()->getTxn()->rollback();
+		oln->getDoc()->rollback();
 		return 0;
 	}
 };
@@ -24,6 +24,7 @@
 #include <Udb/BtreeStore.h>
 #include <QSettings>
 #include <QFile>
+#include <QFileInfo>
 #include <QIcon>
 #include <QMessageBox>
 #include <QFileDialog>
@@ -31,8 +32,11 @@
 #include <QtPlugin>
 #include <QtSingleApplication>
 #include <QtDebug>
+#include <QTextStream>
 #include <iostream>
 #include "AppContext.h"
+#include "Repository.h"
+#include "RepoProfile.h"
 using namespace Oln;
 
 static QtMessageHandler s_oldHandler = 0;
@@ -113,6 +117,8 @@ int main(int argc, char *argv[])
 		
 		QStringList args = QCoreApplication::arguments();
         QString oidArg;
+		QString profileArg;
+		bool profile = false;
 		for( int i = 1; i < args.size(); i++ ) // arg 0 enthält Anwendungspfad
 		{
             if( !args[ i ].startsWith( '-' ) )
@@ -122,9 +128,57 @@ int main(int argc, char *argv[])
             {
                 if( args[ i ].startsWith( "-oid:") )
                     oidArg = args[ i ];
+				else if( args[ i ] == "-profile" || args[ i ].startsWith( "-profile:" ) )
+				{
+					// -profile[:out.json|out.csv]; ohne Datei als JSON auf stdout, ohne GUI
+					profile = true;
+					profileArg = args[ i ].mid( 9 );
+				}
             }
 		}
 		
+		if( profile )
+		{
+			if( path.isEmpty() )
+			{
+				std::cerr << "usage: CrossLine <repository> -profile[:<file.json|file.csv>]" << std::endl;
+				return -1;
+			}
+			if( !path.toLower().endsWith( QLatin1String( AppContext::s_extension ) ) )
+				path += QLatin1String( AppContext::s_extension );
+			// Udb würde eine fehlende Datei neu anlegen
+			if( !QFileInfo( path ).exists() )
+			{
+				std::cerr << "no such repository: " << path.toUtf8().constData() << std::endl;
+				return -1;
+			}
+			RepoSnapshot* snap = Repository::openSnapshot( path );
+			if( snap == 0 )
+			{
+				std::cerr << "cannot open " << path.toUtf8().constData() << std::endl;
+				return -1;
+			}
+			RepoProfile p;
+			const bool ok = p.run( snap );
+			delete snap;
+			if( !ok )
+			{
+				std::cerr << "cannot read " << path.toUtf8().constData() << std::endl;
+				return -1;
+			}
+			if( profileArg.isEmpty() )
+			{
+				QTextStream out( stdout );
+				out.setCodec( "UTF-8" );
+				p.writeJson( out );
+			}else if( !p.write( profileArg ) )
+			{
+				std::cerr << "cannot write " << profileArg.toUtf8().constData() << std::endl;
+				return -1;
+			}
+			return 0;
+		}
+
 		if( path.isEmpty() )
 			path = QFileDialog::getSaveFileName( 0, AppContext::tr("Create/Open Repository - CrossLine"), 
 				QString(), QString( "*%1" ).arg( QLatin1String( AppContext::s_extension ) ), 0, 
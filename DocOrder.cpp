@@ -0,0 +1,85 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "DocOrder.h"
+#include <QStack>
+using namespace Oln;
+
+void DocOrder::setDoc(const Udb::Obj& oln)
+{
+	clear();
+	d_doc = oln;
+	if( oln.isNull() )
+		return;
+	quint32 n = 0;
+	d_pos[ oln.getOid() ] = n++;
+	// Iterativ statt rekursiv, da Outlines beliebig tief sein können
+	QStack<Udb::Obj> stack;
+	Udb::Obj sub = oln.getFirstObj();
+	if( !sub.isNull() )
+		stack.push( sub );
+	while( !stack.isEmpty() )
+	{
+		Udb::Obj o = stack.pop();
+		d_pos[ o.getOid() ] = n++;
+		Udb::Obj next = o;
+		if( next.next() )
+			stack.push( next ); // der Nachfolger kommt erst nach allen Subs dran
+		sub = o.getFirstObj();
+		if( !sub.isNull() )
+			stack.push( sub );
+	}
+}
+
+void DocOrder::clear()
+{
+	d_doc = Udb::Obj();
+	d_pos.clear();
+}
+
+qint32 DocOrder::getPos(Udb::OID oid) const
+{
+	QHash<Udb::OID,quint32>::const_iterator i = d_pos.find( oid );
+	if( i == d_pos.end() )
+		return -1;
+	else
+		return i.value();
+}
+
+Udb::OID DocOrder::seek(const QMap<quint32, Udb::OID>& hits, qint32 cur, bool forward)
+{
+	if( hits.isEmpty() )
+		return 0;
+	if( forward )
+	{
+		QMap<quint32,Udb::OID>::const_iterator i = ( cur < 0 ) ? hits.begin() : hits.upperBound( cur );
+		if( i == hits.end() )
+			return 0;
+		return i.value();
+	}else
+	{
+		if( cur < 0 )
+			return 0;
+		QMap<quint32,Udb::OID>::const_iterator i = hits.lowerBound( cur );
+		if( i == hits.begin() )
+			return 0;
+		--i;
+		return i.value();
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef DOCORDER_H
+#define DOCORDER_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <QHash>
+#include <QMap>
+
+namespace Oln
+{
+	// Dokumentreihenfolge (Pre-Order) der Items eines Outlines; das Outline selber hat Position 0.
+	class DocOrder
+	{
+	public:
+		DocOrder() {}
+		void setDoc( const Udb::Obj& oln );
+		const Udb::Obj& getDoc() const { return d_doc; }
+		void clear();
+		bool isEmpty() const { return d_pos.isEmpty(); }
+		int size() const { return d_pos.size(); }
+		qint32 getPos( Udb::OID ) const; // -1 falls nicht im Outline
+		// Sucht in hits (Position -> OID) den ersten Treffer nach bzw. vor cur
+		static Udb::OID seek( const QMap<quint32,Udb::OID>& hits, qint32 cur, bool forward );
+	private:
+		Udb::Obj d_doc;
+		QHash<Udb::OID,quint32> d_pos;
+	};
+}
+
+#endif // DOCORDER_H
@@ -94,6 +94,28 @@ int DocTabWidget::showWidget( QWidget* w )
 	return -1;
 }
 
+QWidget* DocTabWidget::replaceWidget( int i, QWidget* w )
+{
+	if( i < 0 || i >= count() )
+		return 0;
+	QWidget* old = widget( i );
+	const QString title = tabText( i );
+	const QString tip = tabToolTip( i );
+	const bool cur = currentIndex() == i;
+	// Keine currentChanged während dem Austausch, sonst würde kurzzeitig ein anderes Tab aktiv
+	const bool blocked = blockSignals( true );
+	removeTab( i );
+	insertTab( i, w, title );
+	setTabToolTip( i, tip );
+	if( cur )
+		setCurrentIndex( i );
+	blockSignals( blocked );
+	const int pos = d_order.indexOf( old );
+	if( pos != -1 )
+		d_order[pos] = w;
+	return old;
+}
+
 int DocTabWidget::addDoc( QWidget* w, const Udb::Obj& doc, const QString& title )
 {
     Q_ASSERT( attrText );
@@ -37,6 +37,8 @@ namespace Oln
 		int showDoc( const Udb::Obj& doc ); // Index oder -1
 		int addDoc( QWidget*, const Udb::Obj& doc, const QString& title = QString() );
 		int showWidget( QWidget* );
+		QWidget* replaceWidget( int i, QWidget* ); // Tab behält Position und Titel; gibt altes Widget zurück
+		const QList<QWidget*>& getOrder() const { return d_order; } // zuletzt aktiviertes am Ende
 		Udb::Obj getCurrentObj() const;
         Udb::Obj getDoc( int i ) const;
 		QWidget* getCurrentTab() const;
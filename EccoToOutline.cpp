@@ -34,12 +34,14 @@ Udb::Obj EccoToOutline::createOutline(const Udb::Obj& trace)
 	return oln;
 }
 
-Udb::Obj EccoToOutline::createItem(const Udb::Obj& oln)
+Udb::Obj EccoToOutline::createItem(const Udb::Obj& oln, int level)
 {
 	Udb::Obj o = oln.createObject( TypeOutlineItem );
 	o.setValue( AttrCreatedOn, Stream::DataCell().setDateTime( QDateTime::currentDateTime() ) );
 	o.setValue( AttrItemHome, oln );
-	o.setValue( AttrItemIsExpanded, Stream::DataCell().setBool( true ) ); // RISK
+	// Alles offen hiess, dass das Modell beim Öffnen sämtliche Items erzeugen musste
+	if( d_visibleLevels < 0 || level < d_visibleLevels )
+		o.setValue( AttrItemIsExpanded, Stream::DataCell().setBool( true ) ); // RISK
 	return o;
 }
 
@@ -97,7 +99,7 @@ bool EccoToOutline::parse( QIODevice* ecco, Udb::Obj& trace )
 		}else
 		{
 			assert( obs.size() > 0 );
-			Udb::Obj o = createItem( obs.first() );
+			Udb::Obj o = createItem( obs.first(), level );
 			o.aggregateTo( obs.top() );
 			obs.push( o );
 			obs.top().setValue( AttrText, Stream::DataCell().setString( 
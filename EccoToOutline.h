@@ -28,15 +28,18 @@ namespace Oln
 	class EccoToOutline
 	{
 	public:
-		EccoToOutline(){}
+		EccoToOutline():d_visibleLevels(-1){}
 
 		bool parse( QIODevice* ecco, Udb::Obj& trace ); 
+		// Anzahl Item-Ebenen, die nach dem Öffnen sichtbar sind; tiefere bleiben zugeklappt. -1..alle
+		void setVisibleLevels( int l ) { d_visibleLevels = l; }
 		const QString& getError() const { return d_error; }
 	protected:
 		Udb::Obj createOutline( const Udb::Obj& trace );
-		Udb::Obj createItem(const Udb::Obj& outline);
+		Udb::Obj createItem(const Udb::Obj& outline, int level);
 	private:
 		QString d_error;
+		int d_visibleLevels;
 	};
 }
 
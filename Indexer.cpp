@@ -22,6 +22,8 @@
 #include "Indexer.h"
 #include "TypeDefs.h"
 #include "AppContext.h"
+#include "TitleCache.h"
+#include "Repository.h"
 #include <Udb/Transaction.h>
 #include <Udb/Database.h>
 #include <Udb/ContentObject.h>
@@ -67,6 +69,11 @@ QString Indexer::fetchText( const Udb::Obj& obj, quint32 atom )
 {
 	if( obj.isNull() )
 		return QString();
+	if( atom == AttrText )
+	{
+		if( TitleCache* cache = TitleCache::find( obj.getDb() ) )
+			return cache->get( obj )->d_text;
+	}
 	Stream::DataCell v;
 	Udb::Obj o = obj.getValueAsObj( AttrItemAlias );
 	if( !o.isNull() )
@@ -165,8 +172,9 @@ Udb::Obj Indexer::findText( const QString& pattern, const Udb::Obj& cur, bool fo
 
 const char* Indexer::s_pendingUuid = "{2D826784-B089-4e98-BBB0-F5E4F2F1AD78}";
 
-Indexer::Indexer( Udb::Transaction * txn, QObject * p ):QObject(p)
+Indexer::Indexer( Repository* doc, QObject * p ):QObject(p),d_doc(doc)
 {
+	Udb::Transaction* txn = doc->getTxn();
 	QUuid uuid = s_pendingUuid;
     d_pending = txn->getOrCreateObject( uuid );
 	txn->commit();
@@ -206,6 +214,9 @@ static QString _fetchId( const Udb::Obj& item )
 
 static void indexItem( const Udb::Obj& item, const Udb::Obj& doc, QCLuceneIndexWriter& w, QCLuceneAnalyzer& a )
 {
+	if( item.getValue( AttrItemAlias ).isOid() )
+		return; // Der Body wird nur beim Original indiziert; Aliasse werden in query() ergänzt
+
 	QCLuceneDocument ld;
 
 	const QString text = Indexer::fetchText( item, AttrText );
@@ -331,7 +342,7 @@ bool Indexer::indexIncrements( QWidget* parent )
 				{
 					w.close();
 					QApplication::restoreOverrideCursor();
-					d_pending.getTxn()->rollback();
+					d_doc->rollback();
 					return false;
 				}
 			}
@@ -347,7 +358,7 @@ bool Indexer::indexIncrements( QWidget* parent )
 	{
 		QApplication::restoreOverrideCursor();
 		d_error = QString::fromLatin1( e._awhat );
-		d_pending.getTxn()->rollback();
+		d_doc->rollback();
 		return false;
 	}
 }
@@ -416,7 +427,7 @@ bool Indexer::indexRepository( QWidget* parent, const Udb::Obj &root )
 	{
 		QApplication::restoreOverrideCursor();
 		d_error = QString::fromLatin1( e._awhat );
-		d_pending.getTxn()->rollback();
+		d_doc->rollback();
 		return false;
 	}
 }
@@ -454,6 +465,20 @@ bool Indexer::query( const QString& query, ResultList& result )
 				if( hit.d_doc.isNull() || hit.d_item.isNull() )
 					continue;
 				result.append( hit );
+				// Treffer auf alle Aliasse des Items ausdehnen, statt deren Text mehrfach zu indizieren
+				foreach( Udb::OID aliasId, d_doc->getAliasGraph()->closure( hit.d_item.getOid() ) )
+				{
+					Udb::Obj alias = d_pending.getObject( aliasId );
+					if( alias.isNull() )
+						continue;
+					Hit ah = hit;
+					ah.d_item = alias;
+					ah.d_doc = alias.getValueAsObj( AttrItemHome );
+					ah.d_title = alias.getValue( AttrItemIsTitle ).getBool();
+					ah.d_alias = true;
+					if( !ah.d_doc.isNull() )
+						result.append( ah );
+				}
 			}
 			QApplication::restoreOverrideCursor();
 			delete q;
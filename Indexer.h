@@ -29,6 +29,8 @@ class QWidget;
 
 namespace Oln
 {
+	class Repository;
+
 	class Indexer : public QObject
 	{
 		Q_OBJECT
@@ -50,7 +52,7 @@ namespace Oln
 		static Udb::Obj gotoPrev( const Udb::Obj& obj );
 		static Udb::Obj gotoLast( const Udb::Obj& obj ); // zuunterst
 
-		Indexer( Udb::Transaction*, QObject*  );
+		Indexer( Repository*, QObject*  );
 		bool exists();
 		bool hasPendingUpdates() const;
 		bool indexRepository( QWidget*, const Udb::Obj& root ); // Blocking
@@ -63,6 +65,7 @@ namespace Oln
 	private:
 		QString d_error;
 		Udb::Obj d_pending;
+		Repository* d_doc;
 	};
 }
 
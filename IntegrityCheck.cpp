@@ -0,0 +1,417 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "IntegrityCheck.h"
+#include "Repository.h"
+#include "TypeDefs.h"
+#include "BackRefJob.h"
+#include "AliasGraph.h"
+#include <Udb/Transaction.h>
+#include <Udb/Database.h>
+#include <Udb/DatabaseException.h>
+#include <Udb/Mit.h>
+#include <Udb/Qit.h>
+#include <QProgressDialog>
+#include <QApplication>
+#include <QSettings>
+#include <QFile>
+#include <QTextStream>
+#include "AppContext.h"
+#ifdef _HAS_CLUCENE_
+#include "Indexer.h"
+#endif
+using namespace Oln;
+
+static const int s_progressStep = 4096;
+
+IntegrityWorker::IntegrityWorker(const QString& path, int cachePages, Udb::OID from, Udb::OID to,
+								 const QSet<Udb::OID>& queue, QAtomicInt* cancel, QObject* p):
+	QThread(p),d_path(path),d_cachePages(cachePages),d_from(from),d_to(to),d_queue(queue),d_cancel(cancel)
+{
+}
+
+Udb::OID IntegrityWorker::findOutline(const Udb::Obj& item)
+{
+	// Aggregat-Kette bis zur Wurzel; die Zwischenresultate merken, da Geschwister dieselbe Kette haben
+	QList<Udb::OID> path;
+	Udb::Obj o = item;
+	Udb::OID res = 0;
+	while( !o.isNull() )
+	{
+		QHash<Udb::OID,Udb::OID>::const_iterator i = d_outlineOf.find( o.getOid() );
+		if( i != d_outlineOf.end() )
+		{
+			res = i.value();
+			break;
+		}
+		if( o.getType() == TypeOutline )
+		{
+			res = o.getOid();
+			break;
+		}
+		path.append( o.getOid() );
+		o = o.getParent();
+	}
+	foreach( Udb::OID oid, path )
+		d_outlineOf[oid] = res;
+	return res;
+}
+
+void IntegrityWorker::run()
+{
+	RepoSnapshot* snap = Repository::openSnapshot( d_path, d_cachePages );
+	if( snap == 0 )
+		return;
+	// In Etappen wie RepoProfile::run, damit refresh() die Lesesperre freigibt und die GUI committen kann.
+	// Die Befunde einer Etappe werden erst gemeldet, wenn sie ganz gelesen ist, sonst kämen sie nach
+	// einem Retry doppelt.
+	QList<IntegrityCheck::Finding> found;
+	int step = 0;
+	for( Udb::OID from = d_from; from <= d_to; from += RepoSnapshot::ChunkSize )
+	{
+		const Udb::OID to = qMin( d_to, from + RepoSnapshot::ChunkSize - 1 );
+		bool ok = false;
+		for( int attempt = 0; ; attempt++ )
+		{
+			found.clear();
+			d_outlineOf.clear(); // nach refresh() kann ein Item verschoben sein
+			try
+			{
+				RepoSnapshot::ReadGuard guard;
+				checkRange( snap->getTxn(), from, to, found );
+				ok = true;
+				break;
+			}catch( Udb::DatabaseException& e )
+			{
+				if( !snap->retryAfterBusy( e, attempt ) )
+					break;
+			}
+		}
+		if( !ok )
+			break;
+		foreach( const IntegrityCheck::Finding& f, found )
+			emit sigFinding( f.d_kind, f.d_oid, f.d_ref );
+		step += to - from + 1;
+		if( step >= s_progressStep )
+		{
+			emit sigProgress( step );
+			step = 0;
+		}
+		if( int( *d_cancel ) )
+			break;
+		snap->refresh();
+	}
+	emit sigProgress( step );
+	delete snap;
+}
+
+void IntegrityWorker::checkRange(Udb::Transaction* txn, Udb::OID from, Udb::OID to, QList<IntegrityCheck::Finding>& found)
+{
+	for( Udb::OID oid = from; oid <= to; oid++ )
+	{
+		Udb::Obj o = txn->getObject( oid );
+		if( o.isNull() )
+			continue;
+		const quint32 type = o.getType();
+		if( type == TypeOutlineItem )
+		{
+			const Udb::OID oln = findOutline( o.getParent() );
+			if( oln != 0 && o.getValue( AttrItemHome ).getOid() != oln )
+				found.append( IntegrityCheck::Finding( IntegrityCheck::WrongHome, oid, oln ) );
+		}else if( type == TypeOutline )
+		{
+			if( o.getParent().isNull() && !d_queue.contains( oid ) )
+				found.append( IntegrityCheck::Finding( IntegrityCheck::OrphanOutline, oid, 0 ) );
+		}
+	}
+}
+
+IntegrityCheck::IntegrityCheck(Repository* doc, QObject* p):QObject(p),d_doc(doc),d_report(0),d_out(0),
+	d_running(0),d_total(0),d_done(0),d_found(0),d_maxFindings(0)
+{
+}
+
+IntegrityCheck::~IntegrityCheck()
+{
+	cancel();
+	foreach( IntegrityWorker* w, d_workers )
+		w->wait();
+	closeReport();
+}
+
+bool IntegrityCheck::openReport(const QString& path)
+{
+	closeReport();
+	d_report = new QFile( path );
+	if( !d_report->open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+	{
+		delete d_report;
+		d_report = 0;
+		return false;
+	}
+	// Ein Stream für den ganzen Lauf; die Zeilen gehen laufend in die Datei
+	d_out = new QTextStream( d_report );
+	d_out->setCodec( "UTF-8" );
+	return true;
+}
+
+void IntegrityCheck::closeReport()
+{
+	if( d_out )
+		delete d_out; // flusht
+	d_out = 0;
+	if( d_report )
+		delete d_report; // schliesst die Datei
+	d_report = 0;
+}
+
+void IntegrityCheck::writeReport(const QString& line)
+{
+	if( d_out == 0 )
+		return;
+	*d_out << line << endl;
+}
+
+QString IntegrityCheck::kindName(int k)
+{
+	switch( k )
+	{
+	case DanglingAlias:
+		return tr("dangling alias");
+	case WrongHome:
+		return tr("wrong outline");
+	case OrphanOutline:
+		return tr("outline not in history");
+	case StalePending:
+		return tr("stale journal entry");
+	}
+	return QString();
+}
+
+QString IntegrityCheck::format(const Finding& f) const
+{
+	switch( f.d_kind )
+	{
+	case DanglingAlias:
+		return tr("#%1 %2: refers to missing #%3").arg( f.d_oid ).arg( kindName( f.d_kind ) ).arg( f.d_ref );
+	case WrongHome:
+		return tr("#%1 %2: belongs to outline #%3").arg( f.d_oid ).arg( kindName( f.d_kind ) ).arg( f.d_ref );
+	default:
+		return tr("#%1 %2").arg( f.d_oid ).arg( kindName( f.d_kind ) );
+	}
+}
+
+void IntegrityCheck::checkPending(const QUuid& uuid)
+{
+	Udb::Transaction* txn = d_doc->getTxn();
+	Udb::Obj pending = txn->getObject( uuid );
+	if( pending.isNull() )
+		return;
+	Udb::Mit mit = pending.findCells( Udb::Obj::KeyList() );
+	if( !mit.isNull() ) do
+	{
+		Udb::Mit::KeyList k = mit.getKey();
+		if( k.size() == 1 && k[0].isOid() && txn->getObject( k[0].getOid() ).isNull() &&
+				mit.getValue().getBool() )
+			onFinding( StalePending, k[0].getOid(), pending.getOid() );
+	}while( mit.nextKey() );
+}
+
+void IntegrityCheck::start()
+{
+	if( isRunning() )
+		return;
+	d_findings.clear();
+	d_cancel = 0;
+	d_done = 0;
+	d_found = 0;
+	// Im Speicher bleiben nur so viele Befunde wie ein Reparaturlauf braucht; der Rest steht
+	// im Bericht und wird nach der Reparatur mit einem neuen Check wieder gefunden.
+	d_maxFindings = qMax( 1, AppContext::inst()->getSet()->value( "Check/MaxFindings", 100000 ).toInt() );
+
+	// Die Journale sind klein und werden direkt geprüft
+	checkPending( QUuid( BackRefJob::s_pendingUuid ) );
+#ifdef _HAS_CLUCENE_
+	checkPending( QUuid( Indexer::s_pendingUuid ) );
+#endif
+
+	// Verwaiste Alias-Ziele kennt der AliasGraph schon; die Worker müssen sie nicht suchen
+	AliasGraph* graph = d_doc->getAliasGraph();
+	foreach( Udb::OID target, graph->orphans() )
+	{
+		foreach( Udb::OID alias, graph->referencedBy( target ) )
+			onFinding( DanglingAlias, alias, target );
+	}
+
+	QSet<Udb::OID> queue;
+	Udb::Qit q = d_doc->getRoot().getFirstSlot();
+	if( !q.isNull() ) do
+	{
+		queue.insert( q.getValue().getOid() );
+	}while( q.next() );
+
+	const Udb::OID maxOid = d_doc->getDb()->getMaxOid();
+	d_total = int( maxOid );
+	const int threads = qMax( 1, qMin( QThread::idealThreadCount(),
+		AppContext::inst()->getSet()->value( "Check/MaxThreads", 4 ).toInt() ) );
+	const QString path = d_doc->getDb()->getFilePath();
+	const int cache = Repository::calcCacheSize( path, Repository::getCacheBudget( false ) ) / threads;
+	const Udb::OID part = maxOid / threads + 1;
+	for( int i = 0; i < threads; i++ )
+	{
+		const Udb::OID from = i * part + 1;
+		const Udb::OID to = qMin( maxOid, ( i + 1 ) * part );
+		if( from > to )
+			break;
+		IntegrityWorker* w = new IntegrityWorker( path, cache, from, to, queue, &d_cancel, this );
+		connect( w, SIGNAL(sigFinding(int,quint64,quint64)), this, SLOT(onFinding(int,quint64,quint64)) );
+		connect( w, SIGNAL(sigProgress(int)), this, SLOT(onProgress(int)) );
+		connect( w, SIGNAL(finished()), this, SLOT(onFinished()) );
+		d_workers.append( w );
+		d_running++;
+		w->start( QThread::LowPriority );
+	}
+	if( d_running == 0 )
+		emit sigDone();
+}
+
+void IntegrityCheck::cancel()
+{
+	d_cancel = 1;
+}
+
+void IntegrityCheck::onFinding(int kind, quint64 oid, quint64 ref)
+{
+	const Finding f( kind, oid, ref );
+	writeReport( format( f ) );
+	if( d_findings.size() < d_maxFindings )
+		d_findings.append( f );
+	emit sigFinding( d_found++ );
+}
+
+void IntegrityCheck::onProgress(int oids)
+{
+	d_done += oids;
+	emit sigProgress( d_done, d_total );
+}
+
+void IntegrityCheck::onFinished()
+{
+	IntegrityWorker* w = static_cast<IntegrityWorker*>( sender() );
+	d_workers.removeAll( w );
+	w->deleteLater();
+	d_running--;
+	if( d_running == 0 )
+	{
+		writeReport( tr("Check finished: %1 problems found.").arg( d_found ) );
+		if( d_found > d_findings.size() )
+			writeReport( tr("Only the first %1 can be repaired in this run; check again after repair.")
+						 .arg( d_findings.size() ) );
+		emit sigDone();
+	}
+}
+
+int IntegrityCheck::repair(QWidget* parent)
+{
+	if( isRunning() || d_findings.isEmpty() )
+		return 0;
+	Udb::Transaction* txn = d_doc->getTxn();
+	const int chunk = qMax( 1, AppContext::inst()->getSet()->value( "BackRefs/ChunkSize", 500 ).toInt() );
+	QProgressDialog progress( tr("Repairing repository..."), tr("Abort"), 0, d_findings.size(), parent );
+	progress.setWindowTitle( tr( "CrossLine" ) );
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setAutoClose( true );
+	Udb::Obj root = d_doc->getRoot();
+	// Die Befunde stammen aus Snapshots; jeder wird vor der Reparatur gegen den aktuellen Stand geprüft,
+	// damit z.B. ein inzwischen verschobenes Outline nicht ein zweites Mal in den Root-Queue kommt.
+	QSet<Udb::OID> queue;
+	Udb::Qit q = root.getFirstSlot();
+	if( !q.isNull() ) do
+	{
+		queue.insert( q.getValue().getOid() );
+	}while( q.next() );
+	Udb::Obj::KeyList k(1);
+	int repaired = 0;
+	int i = 0;
+	for( ; i < d_findings.size(); i++ )
+	{
+		const Finding& f = d_findings[i];
+		Udb::Obj o = txn->getObject( f.d_oid );
+		switch( f.d_kind )
+		{
+		case DanglingAlias:
+			// Das Item zeigt danach wieder seinen eigenen Body
+			if( !o.isNull() && o.getValue( AttrItemAlias ).getOid() == f.d_ref &&
+					txn->getObject( f.d_ref ).isNull() )
+			{
+				o.clearValue( AttrItemAlias );
+				repaired++;
+			}
+			break;
+		case WrongHome:
+			if( !o.isNull() && o.getType() == TypeOutlineItem )
+			{
+				Udb::Obj oln = o.getParent();
+				while( !oln.isNull() && oln.getType() != TypeOutline )
+					oln = oln.getParent();
+				if( !oln.isNull() && o.getValue( AttrItemHome ).getOid() != oln.getOid() )
+				{
+					o.setValue( AttrItemHome, oln );
+					repaired++;
+				}
+			}
+			break;
+		case OrphanOutline:
+			if( !o.isNull() && o.getParent().isNull() && !queue.contains( f.d_oid ) )
+			{
+				root.appendSlot( o );
+				queue.insert( f.d_oid );
+				repaired++;
+			}
+			break;
+		case StalePending:
+			{
+				Udb::Obj pending = txn->getObject( f.d_ref );
+				k[0].setOid( f.d_oid );
+				if( !pending.isNull() && o.isNull() && pending.getCell( k ).getBool() )
+				{
+					pending.setCell( k, Stream::DataCell().setNull() );
+					repaired++;
+				}
+			}
+			break;
+		}
+		if( ( i + 1 ) % chunk == 0 )
+		{
+			txn->commit();
+			progress.setValue( i + 1 );
+			if( progress.wasCanceled() )
+			{
+				i++;
+				break;
+			}
+		}
+	}
+	txn->commit();
+	progress.setValue( d_findings.size() );
+	d_found -= i;
+	writeReport( tr("%1 problems repaired, %2 left.").arg( repaired ).arg( d_found ) );
+	d_findings = d_findings.mid( i ); // was noch nicht repariert ist
+	return repaired;
+}
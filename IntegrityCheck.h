@@ -0,0 +1,114 @@
+#ifndef INTEGRITYCHECK_H
+#define INTEGRITYCHECK_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <QThread>
+#include <QAtomicInt>
+#include <QSet>
+#include <QHash>
+
+class QWidget;
+class QFile;
+class QTextStream;
+
+namespace Oln
+{
+	class Repository;
+	class IntegrityWorker;
+
+	// Durchsucht das Repository in parallelen Partitionen nach inkonsistenten Objekten
+	// und repariert sie auf Wunsch in Etappen über die Transaction des Repository.
+	class IntegrityCheck : public QObject
+	{
+		Q_OBJECT
+	public:
+		enum Kind { DanglingAlias, WrongHome, OrphanOutline, StalePending };
+		struct Finding
+		{
+			quint8 d_kind;
+			Udb::OID d_oid;
+			Udb::OID d_ref; // Alias-Ziel, richtiges Outline bzw. Journal-Objekt
+			Finding( quint8 kind = 0, Udb::OID oid = 0, Udb::OID ref = 0 ):d_kind(kind),d_oid(oid),d_ref(ref){}
+		};
+		IntegrityCheck( Repository*, QObject* );
+		~IntegrityCheck();
+		static QString kindName( int );
+		QString format( const Finding& ) const;
+		bool openReport( const QString& path ); // Befunde und Resultate laufend in eine Textdatei
+		void start(); // asynchron
+		void cancel();
+		bool isRunning() const { return d_running > 0; }
+		int getTotal() const { return d_total; }
+		int getFound() const { return d_found; } // inkl. der nur im Bericht stehenden Befunde
+		const QList<Finding>& getFindings() const { return d_findings; } // höchstens Check/MaxFindings
+		int repair( QWidget* ); // Blocking, committed in Etappen
+	signals:
+		void sigFinding( int index );
+		void sigProgress( int done, int total );
+		void sigDone();
+	protected slots:
+		void onFinding( int kind, quint64 oid, quint64 ref );
+		void onProgress( int oids );
+		void onFinished();
+	private:
+		void checkPending( const QUuid& );
+		void closeReport();
+		void writeReport( const QString& );
+		Repository* d_doc;
+		QFile* d_report;
+		QTextStream* d_out;
+		QList<Finding> d_findings;
+		QList<IntegrityWorker*> d_workers;
+		QAtomicInt d_cancel;
+		int d_running;
+		int d_total;
+		int d_done;
+		int d_found;
+		int d_maxFindings;
+	};
+
+	// Prüft einen OID-Bereich mit einem eigenen RepoSnapshot
+	class IntegrityWorker : public QThread
+	{
+		Q_OBJECT
+	public:
+		IntegrityWorker( const QString& path, int cachePages, Udb::OID from, Udb::OID to,
+						 const QSet<Udb::OID>& queue, QAtomicInt* cancel, QObject* );
+	signals:
+		void sigFinding( int kind, quint64 oid, quint64 ref );
+		void sigProgress( int oids );
+	protected:
+		void run();
+		void checkRange( Udb::Transaction*, Udb::OID from, Udb::OID to, QList<IntegrityCheck::Finding>& );
+		Udb::OID findOutline( const Udb::Obj& );
+	private:
+		QString d_path;
+		int d_cachePages;
+		Udb::OID d_from;
+		Udb::OID d_to;
+		QSet<Udb::OID> d_queue; // Outlines im Root-Queue; implizit geteilt
+		QHash<Udb::OID,Udb::OID> d_outlineOf; // Item -> Outline, schon bestimmt
+		QAtomicInt* d_cancel;
+	};
+}
+
+#endif // INTEGRITYCHECK_H
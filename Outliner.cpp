@@ -39,6 +39,8 @@
 #include <QToolButton>
 #include <QClipboard>
 #include <QIcon>
+#include <QLabel>
+#include <QScrollBar>
 #include "TypeDefs.h"
 #include "DocTraceMdl.h"
 #include "EccoToOutline.h"
@@ -49,6 +51,7 @@
 #include "ChangeNameDlg.h"
 #include <Oln2/OutlineToHtml.h>
 #include <Oln2/OutlineItem.h>
+#include <Udb/DatabaseException.h>
 #include <QMimeData>
 #include <QTabWidget>
 #include <QtDebug>
@@ -58,9 +61,25 @@
 #include "Binding.h"
 #endif
 #include "Repository.h"
+#include "BackRefJob.h"
+#include "IntegrityCheck.h"
+#include "RepoProfile.h"
+#include "Backup.h"
+#include "Archiver.h"
+#include <QStatusBar>
+#include <QTimer>
+#include <QProgressDialog>
+#include <QDialog>
+#include <QPlainTextEdit>
+#include <QProgressBar>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QVBoxLayout>
 using namespace Oln;
 using namespace Gui;
 
+static const int s_maxReportLines = 1000; // im Dialog von Check Repository
+
 Outliner::Outliner(Repository *doc, QWidget *parent)
     : QMainWindow(parent), d_pushBackLock( 0 ), d_doc( doc ), d_show(Normal)
 {
@@ -91,9 +110,22 @@ Outliner::Outliner(Repository *doc, QWidget *parent)
 	setCorner( Qt::TopLeftCorner, Qt::LeftDockWidgetArea );
 
 	setupTrace();
+	AppContext::phase( "history" );
 	setupSearch();
 	setupSearch2();
+	AppContext::phase( "search" );
 	setupTerminal();
+	d_backRefs = new BackRefJob( d_doc, this );
+	d_check = 0;
+	d_backup = 0;
+	d_backupScheduled = false;
+	const int backupMin = AppContext::inst()->getSet()->value( "Backup/IntervalMin", 0 ).toInt();
+	if( backupMin > 0 )
+	{
+		QTimer* timer = new QTimer( this );
+		connect( timer, SIGNAL(timeout()), this, SLOT(onScheduledBackup()) );
+		timer->start( backupMin * 60000 );
+	}
 
 	Oln::OutlineUdbMdl::registerPixmap( TypeOutlineItem, QString( ":/CrossLine/Images/outline_item.png" ) );
 	Oln::OutlineUdbMdl::registerPixmap( TypeOutline, QString( ":/CrossLine/Images/outline.png" ) );
@@ -102,10 +134,12 @@ Outliner::Outliner(Repository *doc, QWidget *parent)
 	setCaption();
 	setupAliasList();
 	QDesktopServices::setUrlHandler( "oid", this, "onOpenOid" );
+	AppContext::phase( "menus and alias list" );
 
 	Stream::DataReader r( d_doc->getRoot().getValue(AttrRootDockList) );
 	while( r.nextToken() == Stream::DataReader::Slot )
-		showAsDock( d_doc->getTxn()->getObject( r.readValue().getOid() ) );
+		showAsDock( d_doc->getTxn()->getObject( r.readValue().getOid() ), true );
+	AppContext::phase( "docks" );
 
 	QVariant state = AppContext::inst()->getSet()->value( "MainFrame/State/" +
 		d_doc->getDb()->getDbUuid().toString() ); // Da DB-individuelle Docks
@@ -146,7 +180,17 @@ Outliner::Outliner(Repository *doc, QWidget *parent)
 	Binding::addView( this );
 #endif
 
+	// Erst nach dem ersten Paint laden, damit das Fenster sofort bedienbar ist
+	QMetaObject::invokeMethod( this, "onOpenAutoStart", Qt::QueuedConnection );
+}
+
+void Outliner::onOpenAutoStart()
+{
+	// showOid kann inzwischen bereits ein anderes Outline angezeigt haben; dieses bleibt vorne
+	QWidget* cur = d_tab->getCurrentTab();
 	gotoItem( d_doc->getRoot().getValueAsObj(AttrAutoOpen) );
+	if( cur )
+		d_tab->showWidget( cur );
 }
 
 void Outliner::onOpenOid( QUrl url )
@@ -162,7 +206,10 @@ void Outliner::onOpenOid( QUrl url )
 	}
 	if( !l.isEmpty() )
 		id = l[0].toLong();
-    gotoItem( d_doc->getTxn()->getObject( id ) );
+	Udb::Obj o = d_doc->getTxn()->getObject( id );
+	if( o.isNull() && openArchived( id ) )
+		return;
+    gotoItem( o );
 }
 
 void Outliner::onFollowUrl(const QUrl & url)
@@ -182,18 +229,284 @@ void Outliner::onFollowUrl(const QUrl & url)
 
 void Outliner::onRebuildBackRefs()
 {
-	ENABLED_IF(true);
+	ENABLED_IF( !d_doc->getDb()->isReadOnly() );
+
+	// Nur die seit dem letzten Update geänderten Items
+	const int pending = d_backRefs->getPendingCount();
+	if( pending == 0 )
+	{
+		QMessageBox::information( this, tr("Update Back Reference Index - CrossLine"),
+			tr("No changes since the last update. Use 'Rebuild All Back References' to rebuild everything." ) );
+		return;
+	}
+	const bool done = d_backRefs->run( this );
+	QMessageBox::information( this, tr("Update Back Reference Index - CrossLine"),
+		tr("%1 of %2 changed items updated." )
+		.arg( done ? pending : pending - d_backRefs->getPendingCount() ).arg( pending ) );
+}
+
+void Outliner::onRebuildAllBackRefs()
+{
+	ENABLED_IF( !d_doc->getDb()->isReadOnly() );
 
-	if( QMessageBox::warning( this, tr("Update Back Reference Index - CrossLine"),
-		tr("This operation can take some Time. Do you want to continue?" ),
+	if( QMessageBox::warning( this, tr("Rebuild Back Reference Index - CrossLine"),
+		tr("Rebuilding all references can take some Time. "
+		   "Do you want to continue?" ),
 		QMessageBox::Yes | QMessageBox::No, QMessageBox::No ) == QMessageBox::No )
 		return;
 
 	QApplication::setOverrideCursor( Qt::WaitCursor );
 	OutlineItem::updateAllRefs( d_doc->getTxn() );
+	d_backRefs->clear();
 	QApplication::restoreOverrideCursor();
 }
 
+void Outliner::onProfile()
+{
+	ENABLED_IF(true);
+
+	QFileInfo info( d_doc->getDb()->getFilePath() );
+	QString filter;
+	const QString path = QFileDialog::getSaveFileName( this, tr("Profile Repository"),
+		QDir( d_lastPath ).absoluteFilePath( info.completeBaseName() + QLatin1String(".json") ),
+		"JSON (*.json);;CSV (*.csv)", &filter, QFileDialog::DontUseNativeDialog );
+	if( path.isNull() )
+		return;
+	d_lastPath = QFileInfo( path ).absolutePath();
+
+	QProgressDialog progress( tr("Profiling repository..."), tr("Abort"), 0,
+							  int( d_doc->getDb()->getMaxOid() ), this );
+	progress.setWindowTitle( tr( "CrossLine" ) );
+	progress.setWindowModality(Qt::WindowModal);
+	RepoProfile p;
+	if( !p.run( d_doc->getTxn(), &progress ) )
+		return;
+	if( !p.write( path ) )
+		QMessageBox::critical( this, tr("Profile Repository" ), tr( "cannot open '%1' for writing" ).arg(path) );
+}
+
+void Outliner::onCompactIndex()
+{
+	ENABLED_IF( d_backup == 0 );
+
+	if( QMessageBox::warning( this, tr("Compact Search Index"),
+		tr("The search index is rebuilt from scratch. This will take some minutes.\n"
+		   "Do you want to continue?" ),
+		QMessageBox::Yes | QMessageBox::No, QMessageBox::No ) == QMessageBox::No )
+		return;
+
+	const QString path = d_doc->getDb()->getFilePath();
+	const QString index = SearchView2::getIndexPath( d_doc->getTxn() );
+	const qint64 sizeBefore = QFileInfo( index ).size();
+	const qint64 freeBefore = qMax( Repository::getFreeBytes( index ), qint64( 0 ) );
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	const qint64 scanBefore = Repository::timeScan( index );
+	QApplication::restoreOverrideCursor();
+	if( !d_sv2->compactIndex() )
+		return;
+	const qint64 sizeAfter = QFileInfo( index ).size();
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	const qint64 scanAfter = Repository::timeScan( index );
+	QApplication::restoreOverrideCursor();
+	// RISK: die Repository-Datei selber kann nicht neu geschrieben werden, da die Links zwischen den
+	// Objekten über die OIDs laufen; ihre freien Pages werden von neuen Objekten wiederverwendet.
+	QMessageBox::information( this, tr("Compact Search Index"),
+		tr("Index: %1 KB before, %2 KB after, %3 KB reclaimed (%4 KB were free pages).\n"
+		   "Index scan: %5 ms before, %6 ms after.\n"
+		   "Repository: %7 KB free pages, reused for new objects.")
+		.arg( sizeBefore / 1024 ).arg( sizeAfter / 1024 ).arg( qMax( sizeBefore - sizeAfter, qint64( 0 ) ) / 1024 )
+		.arg( freeBefore / 1024 ).arg( scanBefore ).arg( scanAfter )
+		.arg( qMax( Repository::getFreeBytes( path ), qint64( 0 ) ) / 1024 ) );
+}
+
+void Outliner::onArchive()
+{
+	ENABLED_IF( !d_doc->getDb()->isReadOnly() && d_backup == 0 );
+
+	bool ok;
+	const int months = QInputDialog::getInt( this, tr("Archive Outlines"),
+		tr("Move outlines with a valuta older than this number of months to the archive:"),
+		AppContext::inst()->getSet()->value( "Archive/AgeMonths", 24 ).toInt(), 1, 1200, 1, &ok );
+	if( !ok )
+		return;
+	AppContext::inst()->getSet()->setValue( "Archive/AgeMonths", months );
+
+	// Was in Tabs oder Docks offen ist, bleibt im Repository
+	QSet<Udb::OID> open;
+	for( int i = 0; i < d_tab->count(); i++ )
+		open.insert( d_tab->getDoc( i ).getOid() );
+	foreach( Udb::OID oid, d_dockOrder )
+		open.insert( oid );
+	Archiver a( d_doc );
+	const QList<Udb::Obj> olns = a.findCandidates( QDateTime::currentDateTime().addMonths( -months ), open );
+	if( olns.isEmpty() )
+	{
+		QMessageBox::information( this, tr("Archive Outlines"), tr("There are no outlines to archive.") );
+		return;
+	}
+	if( QMessageBox::question( this, tr("Archive Outlines"),
+		tr("%1 outlines will be moved to '%2'. Do you want to continue?")
+		.arg( olns.size() ).arg( a.getArchivePath() ),
+		QMessageBox::Yes | QMessageBox::No, QMessageBox::No ) == QMessageBox::No )
+		return;
+	int n = 0;
+	try
+	{
+		n = a.run( olns, this );
+	}catch( Udb::DatabaseException& e )
+	{
+		// Was schon committed ist, bleibt ausgelagert; das angefangene Outline bleibt im Repository
+		a.rollback();
+		QMessageBox::critical( this, tr("Archive Outlines"),
+			tr("Database Error: [%1] %2").arg( e.getCodeString() ).arg( e.getMsg() ) );
+		return;
+	}
+	if( n < 0 )
+		QMessageBox::critical( this, tr("Archive Outlines"), a.getError() );
+	else
+		QMessageBox::information( this, tr("Archive Outlines"),
+			tr("%1 outlines archived, %2 skipped because of aliases to or from other outlines or copy errors.")
+			.arg( n ).arg( a.getSkipped() ) );
+}
+
+void Outliner::onCheckIntegrity()
+{
+	ENABLED_IF(true);
+
+	QDialog dlg( this );
+	dlg.setWindowTitle( tr("Check Repository - CrossLine") );
+	QVBoxLayout* vbox = new QVBoxLayout( &dlg );
+	QProgressBar* bar = new QProgressBar( &dlg );
+	vbox->addWidget( bar );
+	QPlainTextEdit* report = new QPlainTextEdit( &dlg );
+	report->setReadOnly( true );
+	report->setMinimumSize( 500, 300 );
+	vbox->addWidget( report );
+	QDialogButtonBox* bb = new QDialogButtonBox( QDialogButtonBox::Close, Qt::Horizontal, &dlg );
+	QPushButton* repair = bb->addButton( tr("Repair"), QDialogButtonBox::ActionRole );
+	repair->setEnabled( false );
+	vbox->addWidget( bb );
+	connect( bb, SIGNAL(rejected()), &dlg, SLOT(reject()) );
+	connect( repair, SIGNAL(clicked()), &dlg, SLOT(accept()) );
+
+	IntegrityCheck check( d_doc, &dlg );
+	// Die Befunde werden laufend angezeigt, während die Worker noch suchen
+	connect( &check, SIGNAL(sigFinding(int)), this, SLOT(onIntegrityFinding(int)) );
+	connect( &check, SIGNAL(sigProgress(int,int)), this, SLOT(onIntegrityProgress(int,int)) );
+	connect( &check, SIGNAL(sigDone()), this, SLOT(onIntegrityDone()) );
+	d_check = &check;
+	d_checkReport = report;
+	d_checkBar = bar;
+	d_checkRepair = repair;
+	// Der Dialog zeigt nur den Anfang; vollständig steht der Bericht neben dem Repository
+	const QString reportPath = d_doc->getDb()->getFilePath() + QLatin1String(".check.txt");
+	if( check.openReport( reportPath ) )
+		report->appendPlainText( tr("Writing report to '%1'").arg( reportPath ) );
+	else
+		report->appendPlainText( tr("Cannot write report to '%1'").arg( reportPath ) );
+	check.start();
+	while( true )
+	{
+		if( dlg.exec() != QDialog::Accepted )
+			break;
+		// Repair
+		repair->setEnabled( false );
+		const int n = check.repair( &dlg );
+		report->appendPlainText( tr("%1 problems repaired, %2 left.").arg( n ).arg( check.getFound() ) );
+		if( check.getFound() > check.getFindings().size() )
+			report->appendPlainText( tr("Run the check again to repair the remaining problems.") );
+	}
+	check.cancel();
+	d_check = 0;
+}
+
+void Outliner::onIntegrityFinding(int i)
+{
+	if( d_check == 0 )
+		return;
+	if( i < s_maxReportLines && i < d_check->getFindings().size() )
+		d_checkReport->appendPlainText( d_check->format( d_check->getFindings()[i] ) );
+	else if( i == s_maxReportLines )
+		d_checkReport->appendPlainText( tr("... more problems only in the report file") );
+}
+
+void Outliner::onIntegrityProgress(int done, int total)
+{
+	if( d_check )
+	{
+		d_checkBar->setMaximum( total );
+		d_checkBar->setValue( done );
+	}
+}
+
+void Outliner::onIntegrityDone()
+{
+	if( d_check == 0 )
+		return;
+	d_checkBar->setValue( d_checkBar->maximum() );
+	d_checkReport->appendPlainText( tr("Check finished: %1 problems found.").arg( d_check->getFound() ) );
+	if( d_check->getFound() > d_check->getFindings().size() )
+		d_checkReport->appendPlainText( tr("Only the first %1 can be repaired in this run; check again after repair.")
+										.arg( d_check->getFindings().size() ) );
+	d_checkRepair->setEnabled( !d_check->getFindings().isEmpty() && !d_doc->getDb()->isReadOnly() );
+}
+
+void Outliner::onBackup()
+{
+	ENABLED_IF( d_backup == 0 );
+	startBackup( false );
+}
+
+void Outliner::onScheduledBackup()
+{
+	if( d_backup == 0 )
+		startBackup( true );
+}
+
+void Outliner::startBackup(bool scheduled)
+{
+	const QString path = d_doc->getDb()->getFilePath();
+	d_backup = new Backup( path,
+		AppContext::inst()->getSet()->value( "Backup/Dir", Backup::defaultDir( path ) ).toString(), this );
+	d_backupScheduled = scheduled;
+	connect( d_backup, SIGNAL(sigProgress(int,int)), this, SLOT(onBackupProgress(int,int)) );
+	connect( d_backup, SIGNAL(finished()), this, SLOT(onBackupDone()) );
+	d_backup->start( QThread::LowPriority );
+}
+
+void Outliner::onBackupProgress(int done, int total)
+{
+	if( total > 0 )
+		statusBar()->showMessage( tr("Backup %1%").arg( qint64( done ) * 100 / total ) );
+}
+
+void Outliner::onBackupDone()
+{
+	Backup* b = d_backup;
+	d_backup = 0;
+	if( b == 0 )
+		return;
+	statusBar()->clearMessage();
+	if( b->getResult() == Backup::Ok )
+	{
+		Backup::rotate( d_doc->getDb()->getFilePath(), QFileInfo( b->getTarget() ).absolutePath(),
+						AppContext::inst()->getSet()->value( "Backup/Keep", 10 ).toInt() );
+		if( d_backupScheduled )
+			statusBar()->showMessage( tr("Backup saved to %1").arg( b->getTarget() ), 5000 );
+		else
+			QMessageBox::information( this, tr("Backup Repository"),
+									  tr("Backup saved to '%1'").arg( b->getTarget() ) );
+	}else if( b->getResult() != Backup::Canceled )
+	{
+		// Der nächste geplante Lauf versucht es wieder
+		if( d_backupScheduled )
+			statusBar()->showMessage( tr("Backup failed: %1").arg( b->getError() ), 5000 );
+		else
+			QMessageBox::critical( this, tr("Backup Repository"), tr("Backup failed: %1").arg( b->getError() ) );
+	}
+	b->deleteLater();
+}
+
 void Outliner::onAutoStart()
 {
 	Udb::Obj oln = getCurrentDoc( true );
@@ -209,25 +522,27 @@ void Outliner::onAutoStart()
 
 OutlineUdbCtrl *Outliner::addOrShowTab( const Udb::Obj& oln, bool setCurrent, bool addNew )
 {
+	if( Archiver::isArchived( oln ) )
+	{
+		openArchived( oln.getOid() );
+		return 0;
+	}
 #ifdef _HAS_LUA_
 	Binding::setCurrentObject( oln );
 #endif
-	int pos = d_tab->showDoc( oln );
+	int pos = d_tab->showDoc( oln ); // ein ausgelagertes Tab wird dabei in onTabChanged neu aufgebaut
 	QWidget* w = 0;
 	Oln::OutlineUdbCtrl* ctrl = 0;
 	if( pos == -1 )
 	{
 		QApplication::setOverrideCursor( Qt::WaitCursor );
-		ctrl = OutlineUdbCtrl::create( d_tab, d_doc->getTxn() );
+		ctrl = createTabCtrl( oln, setCurrent );
 		w = ctrl->getTree();
-		connect( ctrl, SIGNAL( sigCurrentChanged( quint64 ) ), this, SLOT( onCurrentItemChanged( quint64 ) ) );
-		connect( ctrl, SIGNAL(sigUrlActivated(QUrl)), this, SLOT(onFollowUrl(QUrl)) ); //, Qt::QueuedConnection );
-        connect( ctrl, SIGNAL(sigLinkActivated(quint64)), this, SLOT(onSearchItemActivated(quint64)) );
-		ctrl->setOutline( oln, setCurrent );
 		if( addNew )
             ctrl->addItem();
 		pos = d_tab->addDoc( w, oln, TypeDefs::prettyTitle( oln ) );
 		QApplication::restoreOverrideCursor();
+		evictTabs();
 	}else
 	{
 		w = d_tab->widget( pos );
@@ -243,8 +558,87 @@ OutlineUdbCtrl *Outliner::addOrShowTab( const Udb::Obj& oln, bool setCurrent, bo
 	return ctrl;
 }
 
+OutlineUdbCtrl* Outliner::createTabCtrl(const Udb::Obj& oln, bool setCurrent)
+{
+	OutlineUdbCtrl* ctrl = OutlineUdbCtrl::create( d_tab, d_doc->getTxn() );
+	connect( ctrl, SIGNAL( sigCurrentChanged( quint64 ) ), this, SLOT( onCurrentItemChanged( quint64 ) ) );
+	connect( ctrl, SIGNAL(sigUrlActivated(QUrl)), this, SLOT(onFollowUrl(QUrl)) ); //, Qt::QueuedConnection );
+	connect( ctrl, SIGNAL(sigLinkActivated(quint64)), this, SLOT(onSearchItemActivated(quint64)) );
+	d_doc->prefetch( oln );
+	ctrl->setOutline( oln, setCurrent );
+	return ctrl;
+}
+
+void Outliner::evictTabs()
+{
+	// Die am längsten nicht benutzten Tabs geben Ctrl und Modell frei; übrig bleibt ein Platzhalter
+	// mit aktuellem Item und Scroll-Position. Der Expand-Zustand steht ohnehin in der Datenbank.
+	const int budget = AppContext::inst()->getSet()->value( "Outliner/MaxLiveTabs", 10 ).toInt();
+	if( budget <= 0 )
+		return;
+	const QList<QWidget*> order = d_tab->getOrder(); // Kopie, da replaceWidget die Liste ändert
+	int live = 0;
+	foreach( QWidget* w, order )
+	{
+		if( !d_tabStubs.contains( w ) && !d_tab->getDoc( d_tab->indexOf( w ) ).isNull() )
+			live++;
+	}
+	for( int i = 0; i < order.size() && live > budget; i++ )
+	{
+		QWidget* w = order[i];
+		const int pos = d_tab->indexOf( w );
+		if( pos == -1 || pos == d_tab->currentIndex() || d_tabStubs.contains( w ) ||
+				d_tab->getDoc( pos ).isNull() )
+			continue;
+		OutlineTree* tree = dynamic_cast<OutlineTree*>( w );
+		if( tree == 0 )
+			continue;
+		_TabState state;
+		state.d_current = tree->model()->data( tree->currentIndex(), Oln::OutlineMdl::OidRole ).toULongLong();
+		state.d_scroll = tree->verticalScrollBar()->value();
+		QLabel* stub = new QLabel( tr("Loading..."), d_tab );
+		stub->setAlignment( Qt::AlignCenter );
+		connect( stub, SIGNAL(destroyed(QObject*)), this, SLOT(onTabStubDestroyed(QObject*)) );
+		d_tabStubs[stub] = state;
+		d_tab->replaceWidget( pos, stub );
+		w->deleteLater(); // Ctrl und Modell sind Kinder des Trees
+		live--;
+	}
+}
+
+void Outliner::restoreTab(int pos)
+{
+	QWidget* stub = d_tab->widget( pos );
+	if( !d_tabStubs.contains( stub ) )
+		return;
+	const _TabState state = d_tabStubs.take( stub );
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	OutlineUdbCtrl* ctrl = createTabCtrl( d_tab->getDoc( pos ), state.d_current == 0 );
+	d_tab->replaceWidget( pos, ctrl->getTree() );
+	stub->deleteLater();
+	d_pushBackLock++;
+	if( state.d_current )
+		ctrl->gotoItem( state.d_current );
+	d_pushBackLock--;
+	ctrl->getTree()->verticalScrollBar()->setValue( state.d_scroll );
+	QApplication::restoreOverrideCursor();
+	evictTabs();
+}
+
+void Outliner::onTabStubDestroyed(QObject* o)
+{
+	d_tabStubs.remove( static_cast<QWidget*>( o ) );
+}
+
 Outliner::~Outliner()
 {
+	if( d_backup )
+	{
+		// Eine abgebrochene Kopie hinterlässt nur die .part Dateien
+		d_backup->disconnect( this );
+		d_backup->cancel();
+		d_backup->wait();
+	}
 #ifdef _HAS_LUA_
 	Binding::removeView( this );
 #endif
@@ -291,6 +685,8 @@ void Outliner::setupMenu()
 	new AutoShortcut( tr("CTRL+SHIFT+F"), this, this,  SLOT(onSearch()) );
 #endif
 	new AutoShortcut( tr("CTRL+F"), this, this,  SLOT(onSearch2()) );
+	new AutoShortcut( tr("F3"), this, this,  SLOT(onFindNext()) );
+	new AutoShortcut( tr("SHIFT+F3"), this, this,  SLOT(onFindPrev()) );
 
 }
 
@@ -341,6 +737,8 @@ void Outliner::setupNaviMenu(AutoMenu * sub)
 	sub->addCommand( tr("Forward"), this, SLOT(onGoForward()), tr("ALT+RIGHT") );
 	sub->addSeparator();
 	sub->addCommand( tr("Search Outlines..."),  this, SLOT(onSearch2()), tr("CTRL+F") );
+	sub->addCommand( tr("Find Next"),  this, SLOT(onFindNext()), tr("F3") );
+	sub->addCommand( tr("Find Previous"),  this, SLOT(onFindPrev()), tr("SHIFT+F3") );
 #ifdef _HAS_CLUCENE_
     sub->addCommand( tr("Search with Lucene..."),  this, SLOT(onSearch()), tr("CTRL+SHIFT+F") );
 #endif
@@ -391,6 +789,8 @@ void Outliner::setupAliasList()
 	tree->header()->hide();
 
 	d_aliasList = new RefByItemMdl( tree );
+	d_aliasFlag = false;
+	d_aliasDirty = false;
 	// TODO d_doc->getDb()->addObserver( d_aliasList, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
 
 	tree->setModel( d_aliasList );
@@ -398,6 +798,8 @@ void Outliner::setupAliasList()
 	QDockWidget* dock = createDock( this, tr("Referenced by" ), 0, false );
 	dock->setWidget( tree );
 	addDockWidget( Qt::RightDockWidgetArea, dock );
+	d_aliasDock = dock;
+	connect( dock, SIGNAL(visibilityChanged(bool)), this, SLOT(onAliasDockVisible(bool)) );
 
 	connect( tree, SIGNAL( doubleClicked ( const QModelIndex & ) ), this, SLOT( onAliasDblClck( const QModelIndex & ) ) );
 	connect( tree, SIGNAL( activated ( const QModelIndex & ) ), this, SLOT( onAliasDblClck( const QModelIndex & ) ) );
@@ -406,7 +808,8 @@ void Outliner::setupAliasList()
 void Outliner::setupTrace()
 {
 	d_docTrace = new DocTraceMdl( this );
-	d_doc->getDb()->addObserver( d_docTrace, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
+	d_doc->addObserver( d_docTrace, SLOT(onDbUpdate( Udb::UpdateInfo )) );
+	connect( d_doc, SIGNAL(sigBulkInserted(quint64,quint64)), this, SLOT(onBulkInserted()) );
 	d_docTrace->setQueue( d_doc->getRoot() );
 
 	QTreeView* tree = new QTreeView( this );
@@ -494,6 +897,7 @@ void Outliner::setupSearch2()
 	pop->addCommand( tr("Copy"), d_sv2, SLOT(onCopyRef()), tr("CTRL+C"), true );
 	pop->addSeparator();
 	pop->addCommand( tr("Rebuild Index..."), d_sv2, SLOT(onRebuildIndex()) );
+	pop->addCommand( tr("Index Statistics..."), d_sv2, SLOT(onShowStats()) );
 #ifdef _DEBUG
 	pop->addCommand( tr("Test"), d_sv2, SLOT(onTest()) );
 #endif
@@ -572,7 +976,7 @@ void Outliner::onSetDocName()
 	ENABLED_IF( !o.getValue( AttrItemIsReadOnly ).getBool() && !d_doc->getDb()->isReadOnly());
 	ChangeNameDlg dlg( this );
 	if( dlg.edit( o ) )
-		o.commit();
+		o.commit(); // sofort, damit History, Tabs und TitleCache den neuen Titel zeigen
 }
 
 void Outliner::onSetDocProps()
@@ -639,7 +1043,7 @@ void Outliner::onInsertOutline()
 	dlg.setWindowTitle( tr("New Outline") );
 	if( !dlg.edit( oln ) )
 	{
-		d_doc->getTxn()->rollback();
+		d_doc->rollback();
 		return;
 	}
 
@@ -704,6 +1108,7 @@ void Outliner::onImportHtml()
 	}
 
 	QApplication::setOverrideCursor( Qt::WaitCursor );
+	d_doc->beginBulkLoad();
 
 	HtmlToOutline hi;
 	hi.setContext( info.absoluteDir() );
@@ -711,7 +1116,8 @@ void Outliner::onImportHtml()
 	if( o.isNull() )
 	{
 		QApplication::restoreOverrideCursor();
-		d_doc->getTxn()->rollback();
+		d_doc->rollback();
+		d_doc->endBulkLoad( false );
 		QMessageBox::critical( this, tr("Import HTML Document" ), tr( "Error parsing HTML: %1" ).arg( hi.getError() ) );
 		return;
 	}
@@ -723,6 +1129,7 @@ void Outliner::onImportHtml()
 		o.setValue( AttrText, Stream::DataCell().setString( info.completeBaseName() ) );
 	root.appendSlot( o );
 	d_doc->getTxn()->commit();
+	d_doc->endBulkLoad( true );
 	addOrShowTab( o );
 }
 
@@ -734,6 +1141,7 @@ void Outliner::setCaption()
 
 void Outliner::closeEvent( QCloseEvent * event )
 {
+	d_sv2->saveState();
 	AppContext::inst()->getSet()->setValue("MainFrame/State/" +
 		d_doc->getDb()->getDbUuid().toString(), saveState() );
     AppContext::inst()->getSet()->setValue("MainFrame/Size", geometry() );
@@ -785,18 +1193,22 @@ void Outliner::onImportEcco()
 	}
 	Udb::Database::TxnGuard guard( d_doc->getDb() );
 	QApplication::setOverrideCursor( Qt::WaitCursor );
+	d_doc->beginBulkLoad();
 	EccoToOutline in;
+	in.setVisibleLevels( AppContext::inst()->getSet()->value( "Import/EccoVisibleLevels", 3 ).toInt() );
 	Udb::Obj root = d_doc->getRoot();
 	if( !in.parse( &f, root ) )
 	{
 		QApplication::restoreOverrideCursor();
-		d_doc->getTxn()->rollback();
+		d_doc->rollback();
 		guard.rollback();
+		d_doc->endBulkLoad( false );
 		QMessageBox::critical( this, tr("Import Ecco File" ), tr( "Error parsing file: %1" ).arg( in.getError() ) );
 		return;
 	}
-	QApplication::restoreOverrideCursor();
 	d_doc->getTxn()->commit();
+	d_doc->endBulkLoad( true );
+	QApplication::restoreOverrideCursor();
 }
 
 void Outliner::onImportStream()
@@ -819,6 +1231,7 @@ void Outliner::onImportStream()
 	}
 	Udb::Database::TxnGuard guard( d_doc->getDb() );
 	QApplication::setOverrideCursor( Qt::WaitCursor );
+	d_doc->beginBulkLoad();
 	Stream::DataReader r( &f );
 	Udb::Obj oln;
 	if( r.nextToken(true) == Stream::DataReader::Slot && r.readValue().getArr() == "CrossLineStream" )
@@ -828,8 +1241,9 @@ void Outliner::onImportStream()
 			r.nextToken() != Stream::DataReader::Slot && !r.readValue().isDateTime() )
 		{
 			QApplication::restoreOverrideCursor();
-			d_doc->getTxn()->rollback();
+			d_doc->rollback();
 			guard.rollback();
+			d_doc->endBulkLoad( false );
 			QMessageBox::critical( this, tr("Import Outline Stream" ), tr( "Invalid file format" ) );
 			return;
 		}
@@ -838,8 +1252,9 @@ void Outliner::onImportStream()
 		if( oln.isNull() )
 		{
 			QApplication::restoreOverrideCursor();
-			d_doc->getTxn()->rollback();
+			d_doc->rollback();
 			guard.rollback();
+			d_doc->endBulkLoad( false );
 			QMessageBox::critical( this, tr("Import Outline Stream" ), tr( "Error parsing file: %1" ).arg( in.getError() ) );
 			return;
 		}
@@ -854,8 +1269,9 @@ void Outliner::onImportStream()
 		if( !res.isEmpty() )
 		{
 			QApplication::restoreOverrideCursor();
-			d_doc->getTxn()->rollback();
+			d_doc->rollback();
 			guard.rollback();
+			d_doc->endBulkLoad( false );
 			QMessageBox::critical( this, tr("Import Outline Stream" ), tr( "Error parsing file: %1" ).arg( res.data() ) );
 			return;
 		}
@@ -863,6 +1279,7 @@ void Outliner::onImportStream()
 	Udb::Obj root = d_doc->getRoot();
 	Udb::Qit q = root.appendSlot( oln );
 	d_doc->getTxn()->commit();
+	d_doc->endBulkLoad( true );
 	d_docTraceTree->setCurrentIndex( d_docTrace->getIndex( q ) );
 	addOrShowTab( oln, false );
 	QApplication::restoreOverrideCursor();
@@ -1015,6 +1432,19 @@ void Outliner::showOid(quint64 oid)
     Udb::Obj o = d_doc->getTxn()->getObject( oid );
     if( !o.isNull() )
 		gotoItem( o, true );
+	else
+		openArchived( oid );
+}
+
+bool Outliner::openArchived(Udb::OID oid)
+{
+	QString path;
+	Udb::OID archived = 0;
+	if( !Archiver::locate( d_doc, oid, path, archived ) )
+		return false;
+	// Dasselbe Format wie auf der Kommandozeile bzw. bei QtSingleApplication::sendMessage
+	AppContext::inst()->open( QString("\"%1\" -oid:%2").arg( path ).arg( archived ) );
+	return true;
 }
 
 Udb::Obj Outliner::newOutline(bool showDlg)
@@ -1026,7 +1456,7 @@ Udb::Obj Outliner::newOutline(bool showDlg)
 	dlg.setWindowTitle( tr("New Outline") );
 	if( showDlg && !dlg.edit( oln ) )
 	{
-		d_doc->getTxn()->rollback();
+		d_doc->rollback();
 		return Udb::Obj();
 	}
 	Udb::Obj root = d_doc->getRoot();
@@ -1110,16 +1540,21 @@ void Outliner::onSearchItemActivated( quint64 oid )
 #ifdef _HAS_LUA_
 	Binding::setCurrentObject( o );
 #endif
-		d_aliasList->setObj( o, true );
+		setAliasObj( o, true );
 	}
 }
 
 void Outliner::onTabChanged()
 {
+	if( d_tabStubs.contains( d_tab->getCurrentTab() ) )
+	{
+		restoreTab( d_tab->currentIndex() );
+		d_tab->getCurrentTab()->setFocus();
+	}
 	Udb::Obj o = getCurrentItem(true);
 	if( o.isNull() )
 		o = d_tab->getCurrentObj();
-	d_aliasList->setObj( o, true );
+	setAliasObj( o, true );
 #ifdef _HAS_LUA_
 	Binding::setCurrentObject( o );
 #endif
@@ -1128,7 +1563,7 @@ void Outliner::onTabChanged()
 void Outliner::onDockItemSelected()
 {
 	Udb::Obj o = getCurrentItem(true);
-	d_aliasList->setObj( o, true );
+	setAliasObj( o, true );
 #ifdef _HAS_LUA_
 	Binding::setCurrentObject( o );
 #endif
@@ -1178,8 +1613,37 @@ void Outliner::onCurrentItemChanged( quint64 oid )
 	Udb::Obj home = o.getValueAsObj( AttrItemHome );
 	if( home.isNull() )
 		return;
-	d_aliasList->setObj( o );
-	d_aliasList->focusOn( home );
+	setAliasObj( o, false, home );
+}
+
+void Outliner::onBulkInserted()
+{
+	// Der Trace hat die einzelnen Notifications nicht gesehen; einmal neu laden.
+	d_docTrace->setQueue( d_doc->getRoot() );
+}
+
+void Outliner::setAliasObj(const Udb::Obj& o, bool flag, const Udb::Obj& focus)
+{
+	// Die Liste wird nur nachgeführt, wenn sie sichtbar ist; sonst erst beim Anzeigen
+	d_aliasObj = o;
+	d_aliasFlag = flag;
+	d_aliasFocus = focus;
+	d_aliasDirty = true;
+	if( d_aliasDock->isVisible() )
+		onAliasDockVisible( true );
+}
+
+void Outliner::onAliasDockVisible(bool visible)
+{
+	if( !visible || !d_aliasDirty )
+		return;
+	d_aliasDirty = false;
+	if( d_aliasFlag )
+		d_aliasList->setObj( d_aliasObj, true );
+	else
+		d_aliasList->setObj( d_aliasObj );
+	if( !d_aliasFocus.isNull() )
+		d_aliasList->focusOn( d_aliasFocus );
 }
 
 void Outliner::onSearch()
@@ -1202,6 +1666,32 @@ void Outliner::onSearch2()
 	d_sv2->doNew();
 }
 
+void Outliner::onFindNext()
+{
+	ENABLED_IF( true );
+	findNext( true );
+}
+
+void Outliner::onFindPrev()
+{
+	ENABLED_IF( true );
+	findNext( false );
+}
+
+void Outliner::findNext(bool forward)
+{
+	Udb::Obj cur = getCurrentItem( true );
+	if( cur.isNull() )
+		cur = d_tab->getCurrentObj();
+	if( cur.isNull() )
+		return;
+	Udb::Obj hit = d_sv2->findNext( cur, forward );
+	if( hit.isNull() )
+		QApplication::beep(); // kein weiterer Treffer im aktuellen Outline
+	else
+		gotoItem( hit );
+}
+
 void Outliner::onAbout()
 {
 	ENABLED_IF( true );
@@ -1235,12 +1725,12 @@ void Outliner::onAddDock()
 {
 	Udb::Obj oln = getCurrentDoc( true );
 	ENABLED_IF( !oln.isNull() );
-	for( int i = 0; i < d_docks.size(); i++ )
-		if( d_docks[i]->getOutline().equals( oln ) )
-		{
-			d_docks[i]->getTree()->parentWidget()->show();
-			return;
-		}
+	QDockWidget* dock = findDock( oln );
+	if( dock )
+	{
+		dock->show();
+		return;
+	}
 	showAsDock( oln );
 	streamDocks();
 }
@@ -1248,8 +1738,8 @@ void Outliner::onAddDock()
 void Outliner::streamDocks()
 {
 	Stream::DataWriter dw;
-	for( int i = 0; i < d_docks.size(); i++ )
-		dw.writeSlot( d_docks[i]->getOutline() );
+	for( int i = 0; i < d_dockOrder.size(); i++ )
+		dw.writeSlot( Stream::DataCell().setOid( d_dockOrder[i] ) );
 	Udb::Obj r = d_doc->getRoot();
 	r.setValue( AttrRootDockList, dw.getBml() );
 	r.commit();
@@ -1260,6 +1750,7 @@ OutlineUdbCtrl *Outliner::showInDocks(const Udb::Obj &oln, const Udb::Obj &item)
 	if( d_tab->findDoc(oln) != -1 )
 		return 0; // oln ist bereits in einem Tab offen; suche nicht weiter nach Docks
 
+	loadDockStub( d_dockStubs.key( oln.getOid() ) );
 	foreach( OutlineUdbCtrl* ctrl, d_docks )
 	{
 		if( ctrl->getOutline().equals(oln) )
@@ -1282,12 +1773,60 @@ void Outliner::onRemoveDock()
 	removeDock( oln );
 }
 
-void Outliner::showAsDock( const Udb::Obj& oln )
+void Outliner::showAsDock( const Udb::Obj& oln, bool lazy )
 {
 	if( oln.isNull() )
 		return;
-	QApplication::setOverrideCursor( Qt::WaitCursor );
 	QDockWidget* dock = createDock( this, oln.getValue( AttrText ).toString(), oln.getOid(), true );
+	d_dockOrder.append( oln.getOid() );
+	addDockWidget( Qt::LeftDockWidgetArea, dock );
+	if( lazy )
+	{
+		// Platzhalter; das Outline wird erst geladen, wenn das Dock sichtbar wird
+		QLabel* l = new QLabel( tr("Loading..."), dock );
+		l->setAlignment( Qt::AlignCenter );
+		dock->setWidget( l );
+		d_dockStubs[dock] = oln.getOid();
+		connect( dock, SIGNAL(visibilityChanged(bool)), this, SLOT(onDockStubVisible(bool)) );
+	}else
+		loadDock( dock, oln );
+}
+
+void Outliner::onDockStubVisible(bool visible)
+{
+	if( visible )
+		loadDockStub( static_cast<QDockWidget*>( sender() ) );
+}
+
+OutlineUdbCtrl* Outliner::loadDockStub(QDockWidget* dock)
+{
+	if( !d_dockStubs.contains( dock ) )
+		return 0;
+	const Udb::OID oid = d_dockStubs.take( dock );
+	disconnect( dock, SIGNAL(visibilityChanged(bool)), this, SLOT(onDockStubVisible(bool)) );
+	QWidget* stub = dock->widget();
+	OutlineUdbCtrl* ctrl = loadDock( dock, d_doc->getTxn()->getObject( oid ) );
+	if( stub )
+		stub->deleteLater(); // wir sind ev. in einem Signal des Docks
+	return ctrl;
+}
+
+QDockWidget* Outliner::findDock(const Udb::Obj& oln) const
+{
+	if( oln.isNull() )
+		return 0;
+	QDockWidget* dock = d_dockStubs.key( oln.getOid() );
+	if( dock )
+		return dock;
+	foreach( OutlineUdbCtrl* ctrl, d_docks )
+		if( ctrl->getOutline().equals( oln ) )
+			return static_cast<QDockWidget*>( ctrl->getTree()->parentWidget() );
+	return 0;
+}
+
+OutlineUdbCtrl* Outliner::loadDock( QDockWidget* dock, const Udb::Obj& oln )
+{
+	QApplication::setOverrideCursor( Qt::WaitCursor );
 	Oln::OutlineUdbCtrl* ctrl = OutlineUdbCtrl::create( dock, d_doc->getTxn() );
 	ctrl->getTree()->setShowNumbers( false );
 	ctrl->getTree()->setIndentation( 10 );
@@ -1304,13 +1843,13 @@ void Outliner::showAsDock( const Udb::Obj& oln )
 	d_docks.append( ctrl );
 
 	d_pushBackLock++;
+	d_doc->prefetch( oln );
 	ctrl->setOutline( oln, true );
 	// Durch diesen Trick ist oberstes Item current ohne dass es in backHisto eingefügt wird.
 	// Bei false wird current Event ausgelöst beim ersten Fokus was schwieriger zu vermeiden ist.
 	d_pushBackLock--;
 
 	dock->setWidget( ctrl->getTree() );
-	addDockWidget( Qt::LeftDockWidgetArea, dock );
 	QApplication::restoreOverrideCursor();
 
 	AutoMenu* pop = new AutoMenu( ctrl->getTree(), true );
@@ -1349,6 +1888,7 @@ void Outliner::showAsDock( const Udb::Obj& oln )
 
 	pop->addSeparator();
 	addTopCommands( pop );
+	return ctrl;
 }
 
 int Outliner::dockIndex(const Udb::Obj & oln)
@@ -1361,12 +1901,13 @@ int Outliner::dockIndex(const Udb::Obj & oln)
 
 void Outliner::removeDock(const Udb::Obj & oln)
 {
-	const int cur = dockIndex(oln);
-	if( cur == -1 )
+	QDockWidget* dock = findDock( oln );
+	if( dock == 0 )
 		return;
-	QWidget* dock = d_docks[cur]->getTree()->parentWidget();
-	d_docks.removeAt( cur );
-	removeDockWidget( static_cast<QDockWidget*>( dock ) );
+	d_dockOrder.removeAll( oln.getOid() );
+	if( d_dockStubs.remove( dock ) == 0 )
+		d_docks.removeAt( dockIndex( oln ) );
+	removeDockWidget( dock );
 	dock->deleteLater();
 	streamDocks();
 }
@@ -1396,6 +1937,12 @@ void Outliner::addTopCommands(Gui::AutoMenu * pop )
 	sub->addCommand( tr("Select Outline Font..."), this, SLOT(onSetFont()) );
 	sub->addCommand( tr("Select Application Font..."), this, SLOT(onSetAppFont()) );
 	sub->addCommand( tr("Update Indices..."), this, SLOT(onRebuildBackRefs()) );
+	sub->addCommand( tr("Rebuild All Back References..."), this, SLOT(onRebuildAllBackRefs()) );
+	sub->addCommand( tr("Check Repository..."), this, SLOT(onCheckIntegrity()) );
+	sub->addCommand( tr("Profile Repository..."), this, SLOT(onProfile()) );
+	sub->addCommand( tr("Compact Search Index..."), this, SLOT(onCompactIndex()) );
+	sub->addCommand( tr("Archive Old Outlines..."), this, SLOT(onArchive()) );
+	sub->addCommand( tr("Backup Repository"), this, SLOT(onBackup()) );
 	sub->addCommand( tr("Show FullScreen"), this, SLOT( onFullScreen() ), tr("F11") );
 	QMenu* sub2 = createPopupMenu();
 	sub2->setTitle( tr("Show Window") );
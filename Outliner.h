@@ -23,6 +23,7 @@
 #include <QMainWindow>
 #include <Udb/Obj.h>
 #include <QStack>
+#include <QHash>
 #include <GuiTools/AutoMenu.h>
 
 class QModelIndex;
@@ -31,6 +32,10 @@ class QTabWidget;
 class QToolButton;
 class QMenu;
 class QAction;
+class QDockWidget;
+class QPlainTextEdit;
+class QProgressBar;
+class QPushButton;
 
 namespace Oln
 {
@@ -38,6 +43,9 @@ namespace Oln
 	class DocTraceMdl;
 	class SearchView;
 	class SearchView2;
+	class BackRefJob;
+	class IntegrityCheck;
+	class Backup;
 	class RefByItemMdl;
     class Repository;
     class DocTabWidget;
@@ -50,6 +58,7 @@ namespace Oln
 		~Outliner();
 		bool gotoItem( const Udb::Obj&, bool expand = false, bool checkDocks = true );
         Repository* getDoc() const { return d_doc; }
+		SearchView2* getSearch() const { return d_sv2; }
         void showOid(quint64 oid);
 		Udb::Obj newOutline(bool showDlg = true);
 		Udb::Obj currentDoc() const;
@@ -67,10 +76,19 @@ namespace Oln
 		void setupSearch();
 		void setupSearch2();
 		void setupTerminal();
+		void findNext( bool forward );
 		OutlineUdbCtrl* addOrShowTab( const Udb::Obj&, bool setCurrent = true, bool addNew = false );
+		OutlineUdbCtrl* createTabCtrl( const Udb::Obj&, bool setCurrent );
+		void evictTabs();
+		void restoreTab( int );
+		void startBackup( bool scheduled );
+		bool openArchived( Udb::OID );
 		Udb::Obj getCurrentItem(bool includeRoot = false) const;
 		Udb::Obj getCurrentDoc(bool includeRoot = false) const;
-		void showAsDock( const Udb::Obj& );
+		void showAsDock( const Udb::Obj&, bool lazy = false );
+		OutlineUdbCtrl* loadDock( QDockWidget*, const Udb::Obj& );
+		OutlineUdbCtrl* loadDockStub( QDockWidget* );
+		QDockWidget* findDock( const Udb::Obj& ) const;
 		int dockIndex( const Udb::Obj& );
 		void removeDock( const Udb::Obj& );
 		void streamDocks();
@@ -79,6 +97,7 @@ namespace Oln
         static void toFullScreen( QMainWindow* );
         void addTopCommands( Gui::AutoMenu* );
 		void pushBack(const Udb::Obj & o);
+		void setAliasObj( const Udb::Obj&, bool, const Udb::Obj& focus = Udb::Obj() );
 		// Overrides
 		void closeEvent ( QCloseEvent * event );
 		void changeEvent ( QEvent * event ) ;
@@ -102,6 +121,8 @@ namespace Oln
 		void onSearchItemActivated( quint64 );
 		void onSearch();
 		void onSearch2();
+		void onFindNext();
+		void onFindPrev();
 		void onAbout();
 		void onImportStream();
 		void onSetDocName();
@@ -122,15 +143,53 @@ namespace Oln
 		void onOpenOid( QUrl url );
         void onFollowUrl( const QUrl& );
 		void onRebuildBackRefs();
+		void onRebuildAllBackRefs();
+		void onCheckIntegrity();
+		void onProfile();
+		void onCompactIndex();
+		void onArchive();
+		void onIntegrityFinding(int);
+		void onIntegrityProgress(int,int);
+		void onIntegrityDone();
+		void onBackup();
+		void onScheduledBackup();
+		void onBackupProgress(int,int);
+		void onBackupDone();
 		void onAutoStart();
+		void onOpenAutoStart();
+		void onAliasDockVisible(bool);
+		void onBulkInserted();
+		void onDockStubVisible(bool);
+		void onTabStubDestroyed(QObject*);
 	private:
 		QString d_lastPath;
 		DocTraceMdl* d_docTrace;
 		RefByItemMdl* d_aliasList;
+		QDockWidget* d_aliasDock;
+		Udb::Obj d_aliasObj;
+		Udb::Obj d_aliasFocus;
+		bool d_aliasFlag;
+		bool d_aliasDirty;
 		QTreeView* d_docTraceTree;
-		QList<OutlineUdbCtrl*> d_docks;
+		QList<OutlineUdbCtrl*> d_docks; // nur die geladenen
+		QList<Udb::OID> d_dockOrder; // alle Docks in der Reihenfolge von AttrRootDockList
+		QHash<QDockWidget*,Udb::OID> d_dockStubs; // noch nicht geladen
+		struct _TabState
+		{
+			Udb::OID d_current;
+			int d_scroll;
+			_TabState():d_current(0),d_scroll(0){}
+		};
+		QHash<QWidget*,_TabState> d_tabStubs; // ausgelagerte Tabs
 		SearchView* d_search;
 		SearchView2* d_sv2;
+		BackRefJob* d_backRefs;
+		IntegrityCheck* d_check; // nur während onCheckIntegrity
+		QPlainTextEdit* d_checkReport;
+		QProgressBar* d_checkBar;
+		QPushButton* d_checkRepair;
+		Backup* d_backup; // nur während eine Kopie läuft
+		bool d_backupScheduled;
         Oln::DocTabWidget* d_tab;
 		QList<Udb::OID> d_backHisto; // d_backHisto.last() ist aktuell angezeigtes Objekt
 		QList<Udb::OID> d_forwardHisto;
@@ -0,0 +1,425 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "RepoProfile.h"
+#include "TypeDefs.h"
+#include <Udb/Transaction.h>
+#include <Udb/Database.h>
+#include <Udb/Extent.h>
+#include <Udb/DatabaseException.h>
+#include "Repository.h"
+#include <QProgressDialog>
+#include <QApplication>
+#include <QTextStream>
+#include <QFile>
+#include <QPair>
+#include <QCryptographicHash>
+using namespace Oln;
+
+static const int s_topN = 20;
+static const int s_buckets = 48;
+static const int s_largePayload = 64 * 1024; // Bytes, gespeicherte Form
+static const int s_compressMin = 4096; // Bytes; kleinere Werte lohnen den Aufwand beim Lesen nicht
+static const int s_memoMax = 100000; // Einträge in RepoProfile::d_memo
+
+RepoProfile::RepoProfile():d_objects(0),d_textCount(0),d_textTotal(0),d_largeCount(0),d_largeBytes(0),
+	d_dupCount(0),d_dupBytes(0),d_compCount(0),d_compRaw(0),d_compPacked(0),d_aliases(0),d_dangling(0)
+{
+	d_textSizes.fill( 0, s_buckets );
+	d_fanOut.fill( 0, s_buckets );
+}
+
+int RepoProfile::bucket(qint64 n)
+{
+	int b = 0;
+	while( n > 0 && b < s_buckets - 1 )
+	{
+		n >>= 1;
+		b++;
+	}
+	return b;
+}
+
+QString RepoProfile::bucketName(int b)
+{
+	if( b == 0 )
+		return QLatin1String("0");
+	const qint64 from = qint64(1) << ( b - 1 );
+	const qint64 to = ( qint64(1) << b ) - 1;
+	if( from == to )
+		return QString::number( from );
+	return QString("%1-%2").arg( from ).arg( to );
+}
+
+void RepoProfile::countCompressed(const QByteArray& raw)
+{
+	if( raw.size() < s_compressMin )
+		return;
+	d_compCount++;
+	d_compRaw += raw.size();
+	// qCompress stellt 4 Bytes Länge voran; bei der Speicherung wären sie ebenfalls nötig
+	d_compPacked += qMin( qCompress( raw ).size(), raw.size() );
+}
+
+int RepoProfile::depthOf(Udb::Obj p, Udb::OID& oln)
+{
+	// Tiefe des Items p; die Vorfahren werden gemerkt, damit die Geschwister den Pfad nicht
+	// nochmals lesen. Ist das Memo voll, wird der Pfad halt wieder gelesen.
+	QList<Udb::OID> path;
+	int depth = 0;
+	bool hit = false;
+	while( !p.isNull() && p.getType() == TypeOutlineItem )
+	{
+		QHash<Udb::OID, QPair<int,Udb::OID> >::const_iterator i = d_memo.find( p.getOid() );
+		if( i != d_memo.end() )
+		{
+			depth = i.value().first;
+			oln = i.value().second;
+			hit = true;
+			break;
+		}
+		path.append( p.getOid() );
+		p = p.getParent();
+	}
+	if( !hit )
+		oln = ( !p.isNull() && p.getType() == TypeOutline ) ? p.getOid() : 0;
+	for( int n = path.size() - 1; n >= 0; n-- )
+	{
+		depth++;
+		if( d_memo.size() < s_memoMax )
+			d_memo.insert( path[n], qMakePair( depth, oln ) );
+	}
+	return depth;
+}
+
+void RepoProfile::countObject(const Udb::Obj& o, Udb::Transaction* txn)
+{
+	// Erst alles lesen, dann zählen; scheitert ein Lesen an einer Sperre, ist vom Objekt noch nichts
+	// gezählt und die Etappe kann bei ihm weitermachen.
+	const quint32 type = o.getType();
+	const Stream::DataCell text = o.getValue( AttrText );
+	const Stream::DataCell summary = o.getValue( AttrSummary );
+	const Stream::DataCell alias = o.getValue( AttrItemAlias );
+	const bool isAlias = alias.isOid() && alias.getOid() != 0;
+	const bool dangling = isAlias && txn->getObject( alias.getOid() ).isNull();
+	Udb::OID parent = 0;
+	Udb::OID oln = 0;
+	int depth = 0;
+	if( type == TypeOutlineItem )
+	{
+		const Udb::Obj p = o.getParent();
+		parent = p.getOid();
+		depth = depthOf( p, oln ) + 1;
+	}
+
+	d_objects++;
+	d_types[type]++;
+	if( !text.isNull() )
+	{
+		const qint64 len = text.toString( true ).size();
+		d_textCount++;
+		d_textTotal += len;
+		d_textSizes[ bucket( len ) ]++;
+		const QByteArray raw = text.writeCell();
+		countCompressed( raw );
+		if( raw.size() >= s_largePayload )
+		{
+			d_largeCount++;
+			d_largeBytes += raw.size();
+			const QByteArray hash = QCryptographicHash::hash( raw, QCryptographicHash::Sha1 );
+			if( d_largeHashes.contains( hash ) )
+			{
+				d_dupCount++;
+				d_dupBytes += raw.size();
+			}else
+				d_largeHashes.insert( hash );
+		}
+	}
+	if( !summary.isNull() )
+		countCompressed( summary.writeCell() );
+	if( isAlias )
+	{
+		d_aliases++;
+		if( dangling )
+			d_dangling++;
+	}
+	if( type == TypeOutlineItem )
+	{
+		d_depth[depth]++;
+		if( parent )
+			d_subs[parent]++;
+		if( oln )
+			d_items[oln]++;
+	}
+}
+
+void RepoProfile::finish()
+{
+	// Knoten ohne Subs kommen in d_subs nicht vor
+	const qint64 nodes = d_types.value( TypeOutline ) + d_types.value( TypeOutlineItem );
+	d_fanOut[0] += qMax( qint64(0), nodes - d_subs.size() );
+	QHash<Udb::OID,qint32>::const_iterator s;
+	for( s = d_subs.begin(); s != d_subs.end(); ++s )
+		d_fanOut[ bucket( s.value() ) ]++;
+	d_subs.clear();
+	d_memo.clear();
+	QHash<Udb::OID,qint64>::const_iterator i;
+	for( i = d_items.begin(); i != d_items.end(); ++i )
+	{
+		if( d_largest.size() < s_topN || i.value() > d_largest.begin().key() )
+		{
+			d_largest.insert( i.value(), i.key() );
+			if( d_largest.size() > s_topN )
+				d_largest.erase( d_largest.begin() );
+		}
+	}
+	d_items.clear();
+}
+
+void RepoProfile::readTitles(Udb::Transaction* txn)
+{
+	foreach( Udb::OID oln, d_largest )
+		d_titles[oln] = TypeDefs::prettyTitle( txn->getObject( oln ), false );
+}
+
+bool RepoProfile::run(Udb::Transaction* txn, QProgressDialog* progress)
+{
+	d_path = txn->getDb()->getFilePath();
+	const Udb::OID maxOid = txn->getDb()->getMaxOid();
+	int step = 0;
+	Udb::Extent e( txn );
+	if( e.first() ) do
+	{
+		Udb::Obj o = e.getObj();
+		countObject( o, txn );
+		if( progress && ++step == 1000 )
+		{
+			step = 0;
+			progress->setValue( int( qMin( o.getOid(), maxOid ) ) );
+			if( progress->wasCanceled() )
+				return false;
+		}
+	}while( e.next() );
+	finish();
+	readTitles( txn );
+	if( progress )
+		progress->setValue( progress->maximum() );
+	return true;
+}
+
+bool RepoProfile::run(RepoSnapshot* snap)
+{
+	// In Etappen nach OID statt über die Extent, damit refresh() dazwischen die Lesesperre freigibt;
+	// scheitert eine Etappe an einer Sperre, geht sie nach retryAfterBusy() beim gescheiterten Objekt weiter.
+	d_path = snap->getFilePath();
+	const Udb::OID maxOid = snap->getTxn()->getDb()->getMaxOid();
+	for( Udb::OID from = 1; from <= maxOid; from += RepoSnapshot::ChunkSize )
+	{
+		const Udb::OID to = qMin( maxOid, from + RepoSnapshot::ChunkSize - 1 );
+		Udb::OID oid = from;
+		for( int attempt = 0; ; attempt++ )
+		{
+			try
+			{
+				RepoSnapshot::ReadGuard guard;
+				Udb::Transaction* txn = snap->getTxn();
+				for( ; oid <= to; oid++ )
+				{
+					Udb::Obj o = txn->getObject( oid );
+					if( !o.isNull() )
+						countObject( o, txn );
+				}
+				break;
+			}catch( Udb::DatabaseException& e )
+			{
+				d_memo.clear();
+				if( !snap->retryAfterBusy( e, attempt ) )
+					return false;
+			}
+		}
+		snap->refresh();
+		d_memo.clear(); // nach refresh() kann ein Item verschoben sein
+	}
+	finish();
+	for( int attempt = 0; ; attempt++ )
+	{
+		try
+		{
+			RepoSnapshot::ReadGuard guard;
+			readTitles( snap->getTxn() );
+			return true;
+		}catch( Udb::DatabaseException& e )
+		{
+			if( !snap->retryAfterBusy( e, attempt ) )
+				return false;
+		}
+	}
+}
+
+qint64 RepoProfile::percentile(int p) const
+{
+	// Obergrenze des Buckets, in dem das Perzentil liegt
+	const qint64 limit = ( d_textCount * p + 99 ) / 100;
+	qint64 sum = 0;
+	for( int b = 0; b < d_textSizes.size(); b++ )
+	{
+		sum += d_textSizes[b];
+		if( sum >= limit && sum > 0 )
+			return b == 0 ? 0 : ( qint64(1) << b ) - 1;
+	}
+	return 0;
+}
+
+static QString _typeName( quint32 type )
+{
+	switch( type )
+	{
+	case TypeOutline:
+		return QLatin1String("TypeOutline");
+	case TypeOutlineItem:
+		return QLatin1String("TypeOutlineItem");
+	}
+	return QString::number( type );
+}
+
+static QString _jsonStr( QString str )
+{
+	str.replace( QLatin1Char('\\'), QLatin1String("\\\\") );
+	str.replace( QLatin1Char('"'), QLatin1String("\\\"") );
+	str.replace( QLatin1Char('\n'), QLatin1String("\\n") );
+	return QLatin1Char('"') + str + QLatin1Char('"');
+}
+
+static QString _csvStr( QString str )
+{
+	str.replace( QLatin1Char('"'), QLatin1String("\"\"") );
+	return QLatin1Char('"') + str + QLatin1Char('"');
+}
+
+void RepoProfile::writeJson(QTextStream& out) const
+{
+	out << "{\n";
+	out << "  \"repository\": " << _jsonStr( d_path ) << ",\n";
+	out << "  \"objects\": " << d_objects << ",\n";
+	out << "  \"types\": {";
+	QMap<quint32,qint64>::const_iterator t;
+	for( t = d_types.begin(); t != d_types.end(); ++t )
+		out << ( t == d_types.begin() ? " " : ", " ) << _jsonStr( _typeName( t.key() ) ) << ": " << t.value();
+	out << " },\n";
+	out << "  \"text\": { \"count\": " << d_textCount << ", \"total\": " << d_textTotal
+		<< ", \"p50\": " << percentile( 50 ) << ", \"p90\": " << percentile( 90 )
+		<< ", \"p99\": " << percentile( 99 ) << ", \"histogram\": {";
+	bool first = true;
+	for( int b = 0; b < d_textSizes.size(); b++ )
+	{
+		if( d_textSizes[b] == 0 )
+			continue;
+		out << ( first ? " " : ", " ) << _jsonStr( bucketName( b ) ) << ": " << d_textSizes[b];
+		first = false;
+	}
+	out << " } },\n";
+	out << "  \"depth\": {";
+	QMap<int,qint64>::const_iterator d;
+	for( d = d_depth.begin(); d != d_depth.end(); ++d )
+		out << ( d == d_depth.begin() ? " " : ", " ) << "\"" << d.key() << "\": " << d.value();
+	out << " },\n";
+	out << "  \"fanOut\": {";
+	first = true;
+	for( int b = 0; b < d_fanOut.size(); b++ )
+	{
+		if( d_fanOut[b] == 0 )
+			continue;
+		out << ( first ? " " : ", " ) << _jsonStr( bucketName( b ) ) << ": " << d_fanOut[b];
+		first = false;
+	}
+	out << " },\n";
+	out << "  \"largePayloads\": { \"minBytes\": " << s_largePayload << ", \"count\": " << d_largeCount
+		<< ", \"bytes\": " << d_largeBytes << ", \"duplicates\": " << d_dupCount
+		<< ", \"duplicateBytes\": " << d_dupBytes << " },\n";
+	out << "  \"compression\": { \"minBytes\": " << s_compressMin << ", \"count\": " << d_compCount
+		<< ", \"bytes\": " << d_compRaw << ", \"estimatedCompressed\": " << d_compPacked << " },\n";
+	out << "  \"aliases\": { \"count\": " << d_aliases << ", \"dangling\": " << d_dangling << " },\n";
+	out << "  \"largestOutlines\": [";
+	first = true;
+	QMapIterator<qint64,Udb::OID> i( d_largest );
+	i.toBack();
+	while( i.hasPrevious() )
+	{
+		i.previous();
+		out << ( first ? "\n" : ",\n" ) << "    { \"oid\": " << i.value() << ", \"items\": " << i.key()
+			<< ", \"title\": " << _jsonStr( d_titles.value( i.value() ) ) << " }";
+		first = false;
+	}
+	out << "\n  ]\n}\n";
+}
+
+void RepoProfile::writeCsv(QTextStream& out) const
+{
+	// Eine Zeile je Kennzahl, damit mehrere Läufe einfach aneinandergehängt werden können
+	out << "section,key,value\n";
+	out << "repository,path," << _csvStr( d_path ) << "\n";
+	out << "objects,total," << d_objects << "\n";
+	QMap<quint32,qint64>::const_iterator t;
+	for( t = d_types.begin(); t != d_types.end(); ++t )
+		out << "types," << _typeName( t.key() ) << "," << t.value() << "\n";
+	out << "text,count," << d_textCount << "\n";
+	out << "text,total," << d_textTotal << "\n";
+	out << "text,p50," << percentile( 50 ) << "\n";
+	out << "text,p90," << percentile( 90 ) << "\n";
+	out << "text,p99," << percentile( 99 ) << "\n";
+	for( int b = 0; b < d_textSizes.size(); b++ )
+		if( d_textSizes[b] )
+			out << "textSize," << bucketName( b ) << "," << d_textSizes[b] << "\n";
+	QMap<int,qint64>::const_iterator d;
+	for( d = d_depth.begin(); d != d_depth.end(); ++d )
+		out << "depth," << d.key() << "," << d.value() << "\n";
+	for( int b = 0; b < d_fanOut.size(); b++ )
+		if( d_fanOut[b] )
+			out << "fanOut," << bucketName( b ) << "," << d_fanOut[b] << "\n";
+	out << "largePayloads,count," << d_largeCount << "\n";
+	out << "largePayloads,bytes," << d_largeBytes << "\n";
+	out << "largePayloads,duplicates," << d_dupCount << "\n";
+	out << "largePayloads,duplicateBytes," << d_dupBytes << "\n";
+	out << "compression,count," << d_compCount << "\n";
+	out << "compression,bytes," << d_compRaw << "\n";
+	out << "compression,estimatedCompressed," << d_compPacked << "\n";
+	out << "aliases,count," << d_aliases << "\n";
+	out << "aliases,dangling," << d_dangling << "\n";
+	QMapIterator<qint64,Udb::OID> i( d_largest );
+	i.toBack();
+	while( i.hasPrevious() )
+	{
+		i.previous();
+		out << "largest," << i.value() << "," << i.key() << "\n";
+	}
+}
+
+bool RepoProfile::write(const QString& path) const
+{
+	QFile f( path );
+	if( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+		return false;
+	QTextStream out( &f );
+	out.setCodec( "UTF-8" );
+	if( path.endsWith( QLatin1String(".csv"), Qt::CaseInsensitive ) )
+		writeCsv( out );
+	else
+		writeJson( out );
+	return true;
+}
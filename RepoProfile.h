@@ -0,0 +1,90 @@
+#ifndef REPOPROFILE_H
+#define REPOPROFILE_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <QCoreApplication>
+#include <QMap>
+#include <QVector>
+#include <QSet>
+#include <QHash>
+#include <QPair>
+
+class QProgressDialog;
+class QTextStream;
+
+namespace Oln
+{
+	class RepoSnapshot;
+
+	// Kennzahlen eines Repository in einem Durchgang über die Extent; Tiefe und Fan-Out ergeben sich
+	// aus dem Parent jedes Items, ohne die Outlines nochmals zu durchlaufen. Gemerkt werden nur
+	// Histogramme, die Anzahl Subs je innerem Knoten und die Anzahl Items je Outline.
+	class RepoProfile
+	{
+		Q_DECLARE_TR_FUNCTIONS(RepoProfile)
+	public:
+		RepoProfile();
+		bool run( Udb::Transaction*, QProgressDialog* = 0 ); // false bei Abbruch
+		bool run( RepoSnapshot* ); // in Etappen, ohne die GUI-Commits zu blockieren; false bei Fehler
+		bool write( const QString& path ) const; // *.csv oder sonst JSON
+		void writeJson( QTextStream& ) const;
+		void writeCsv( QTextStream& ) const;
+		static int bucket( qint64 ); // 0, 1, 2-3, 4-7, ...
+		static QString bucketName( int );
+	private:
+		void countObject( const Udb::Obj&, Udb::Transaction* );
+		int depthOf( Udb::Obj parent, Udb::OID& outline );
+		void finish();
+		void readTitles( Udb::Transaction* );
+		void countCompressed( const QByteArray& );
+		qint64 percentile( int ) const;
+		QString d_path;
+		QMap<quint32,qint64> d_types;
+		qint64 d_objects;
+		qint64 d_textCount;
+		qint64 d_textTotal;
+		QVector<qint64> d_textSizes; // Histogramm nach bucket()
+		QMap<int,qint64> d_depth; // Items je Tiefe
+		QVector<qint64> d_fanOut; // Items bzw. Outlines nach Anzahl Subs, Histogramm nach bucket()
+		// Grosse Werte (meist eingebettete Bilder) und wie viel davon mehrfach gespeichert ist. Nur Statistik:
+		// die Werte bleiben inline in AttrText; einen Blob-Store gibt es nicht (braucht Änderungen in Txt/Oln2).
+		qint64 d_largeCount;
+		qint64 d_largeBytes;
+		qint64 d_dupCount;
+		qint64 d_dupBytes;
+		QSet<QByteArray> d_largeHashes; // nur für Werte ab s_largePayload
+		// Was eine zlib-Kompression der Text- und Summary-Werte ab s_compressMin bringen würde; nur eine
+		// Schätzung, gespeichert wird weiterhin unkomprimiert.
+		qint64 d_compCount;
+		qint64 d_compRaw;
+		qint64 d_compPacked;
+		qint64 d_aliases;
+		qint64 d_dangling;
+		QHash<Udb::OID,qint32> d_subs; // innerer Knoten -> Anzahl Subs; wird in finish() zu d_fanOut
+		QHash<Udb::OID,qint64> d_items; // Outline -> Anzahl Items; wird in finish() zu d_largest
+		QHash<Udb::OID, QPair<int,Udb::OID> > d_memo; // Item -> Tiefe und Outline, begrenzt
+		QMultiMap<qint64,Udb::OID> d_largest; // Anzahl Items -> Outline; höchstens s_topN Einträge
+		QMap<Udb::OID,QString> d_titles;
+	};
+}
+
+#endif // REPOPROFILE_H
@@ -20,20 +20,29 @@
 #include "Repository.h"
 #include "TypeDefs.h"
 #include <Udb/DatabaseException.h>
+#include <Udb/Extent.h>
 #include <Oln2/OutlineItem.h>
 #include <QApplication>
 #include <QIcon>
 #include <QFileInfo>
+#include <QFile>
 #include <QDir>
 #include <QSettings>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QThread>
+#include <QTimer>
+#include <QReadWriteLock>
+#include <QElapsedTimer>
+#include <QtDebug>
 #include "AppContext.h"
+#include "AliasGraph.h"
+#include "TitleCache.h"
 using namespace Oln;
 using namespace Udb;
 
 Repository::Repository(QObject *parent) :
-    QObject(parent),d_db(0),d_txn(0)
+    QObject(parent),d_db(0),d_txn(0),d_cacheSize(0),d_bulkFirst(0),d_bulkLoad(false),d_aliasGraph(0),d_titles(0)
 {
 }
 
@@ -59,18 +68,29 @@ bool Repository::open( QString path )
 	try
 	{
 		d_db->open( path );
-		d_db->setCacheSize( 10000 ); // RISK
+		setCacheBudget( 0 );
 		d_txn = new Transaction( d_db, this );
+		AppContext::phase( "open database" );
 		TypeDefs::init( *d_db );
+		AppContext::phase( "TypeDefs::init" );
 		QUuid uuid = AppContext::s_rootUuid;
 		d_root = d_txn->getObject( uuid );
 		if( d_root.isNull() )
 			d_root = d_txn->createObject( uuid );
 		d_txn->commit();
+		AppContext::phase( "root object" );
 		d_txn->setIndividualNotify(false); // RISK
 		OutlineItem::doBackRef();
 		d_txn->addCallback( OutlineItem::itemErasedCallback );
+		d_txn->addObserver( this, SLOT(onTxnUpdate( Udb::UpdateInfo ) ), false );
         d_db->registerDatabase();
+		AppContext::phase( "back references" );
+		d_titles = new TitleCache( d_db,
+			AppContext::inst()->getSet()->value( "Cache/TitleEntries", 5000 ).toInt(), this );
+		addObserver( d_titles, SLOT(onDbUpdate( Udb::UpdateInfo )) );
+		connect( this, SIGNAL(sigBulkInserted(quint64,quint64)), d_titles, SLOT(clear()) );
+		getAliasGraph()->build();
+		AppContext::phase( "alias graph" );
 		return true;
 	}catch( DatabaseException& e )
 	{
@@ -80,3 +100,350 @@ bool Repository::open( QString path )
 	}
 }
 
+
+AliasGraph* Repository::getAliasGraph()
+{
+	if( d_aliasGraph == 0 && d_txn != 0 )
+	{
+		d_aliasGraph = new AliasGraph( d_txn, this );
+		addObserver( d_aliasGraph, SLOT(onDbUpdate( Udb::UpdateInfo )) );
+		// Während dem Bulk Load gingen die Deltas verloren
+		connect( this, SIGNAL(sigBulkInserted(quint64,quint64)), d_aliasGraph, SLOT(addRange(quint64,quint64)) );
+	}
+	return d_aliasGraph;
+}
+
+int Repository::prefetch(const Udb::Obj& oln) const
+{
+	// Die Items eines Outlines werden meist am Stück erzeugt und haben darum benachbarte OIDs.
+	// Statt dem Aggregat-Baum in zufälliger Reihenfolge zu folgen, wird der OID-Bereich nach oln
+	// aufsteigend gelesen, bis maxGap Objekte in Folge nicht zum Outline gehören. Was nachher dazu
+	// kam, lädt das Modell wie bisher einzeln.
+	if( oln.isNull() )
+		return 0;
+	const int maxGap = AppContext::inst()->getSet()->value( "Outliner/PrefetchGap", 1000 ).toInt();
+	if( maxGap <= 0 )
+		return 0;
+	const Udb::OID maxOid = d_db->getMaxOid();
+	QList<Udb::OID> aliasses;
+	int count = 0;
+	int gap = 0;
+	for( Udb::OID oid = oln.getOid() + 1; oid <= maxOid && gap < maxGap; oid++ )
+	{
+		Udb::Obj o = d_txn->getObject( oid );
+		if( o.isNull() || !o.getValueAsObj( AttrItemHome ).equals( oln ) )
+		{
+			gap++;
+			continue;
+		}
+		gap = 0;
+		count++;
+		// Was das Modell beim Aufklappen braucht
+		o.getValue( AttrText );
+		o.getValue( AttrItemIsTitle );
+		o.getValue( AttrItemIsExpanded );
+		const Udb::OID alias = o.getValue( AttrItemAlias ).getOid();
+		if( alias != 0 && ( alias <= oln.getOid() || alias > oid ) )
+			aliasses.append( alias ); // liegt ausserhalb des gelesenen Bereichs
+	}
+	qSort( aliasses );
+	foreach( Udb::OID alias, aliasses )
+		d_txn->getObject( alias ).getValue( AttrText );
+	return count;
+}
+
+RepoSnapshot* Repository::createSnapshot() const
+{
+	if( d_db == 0 )
+		return 0;
+	// Settings nur hier im GUI-Thread lesen
+	return openSnapshot( d_db->getFilePath(), calcCacheSize( d_db->getFilePath(), getCacheBudget( false ) ) );
+}
+
+static const int s_busyRetries = 10;
+static const int s_busyWaitMs = 50; // wächst linear mit jedem Versuch
+static const int s_gateWaits = 200;
+static const int s_gateWaitMs = 5;
+static QReadWriteLock s_readLock; // Etappen der Snapshots lesen, commits der GUI schreiben
+static QAtomicInt s_commitPending; // > 0 von PreCommit bis nach dem commit
+
+RepoSnapshot::ReadGuard::ReadGuard()
+{
+	// Begrenzt warten: wartet der GUI-Thread selber auf den Worker, kommt onCommitDone nie dran
+	for( int i = 0; ; i++ )
+	{
+		s_readLock.lockForRead();
+		if( int( s_commitPending ) == 0 || i >= s_gateWaits )
+			return;
+		s_readLock.unlock();
+		QThread::msleep( s_gateWaitMs );
+	}
+}
+
+RepoSnapshot::ReadGuard::~ReadGuard()
+{
+	s_readLock.unlock();
+}
+
+void Repository::onTxnUpdate(Udb::UpdateInfo info)
+{
+	if( info.d_kind != Udb::UpdateInfo::PreCommit )
+		return;
+	// Neue Etappen sperren und die laufenden zu Ende lesen lassen; freigegeben wird, sobald die
+	// Event Loop wieder dran ist, also auch wenn der commit mit einer Exception scheitert.
+	s_commitPending.ref();
+	s_readLock.lockForWrite();
+	s_readLock.unlock();
+	QTimer::singleShot( 0, this, SLOT(onCommitDone()) );
+}
+
+void Repository::onCommitDone()
+{
+	s_commitPending.deref();
+}
+
+RepoSnapshot* Repository::openSnapshot(const QString& path, int cachePages)
+{
+	// Eigene Database und Transaction, nicht registriert; damit gehen keine Notifications an die GUI
+	// und ungespeicherte Änderungen der GUI-Transaction sind nicht sichtbar.
+	for( int attempt = 0; ; attempt++ )
+	{
+		RepoSnapshot* s = new RepoSnapshot();
+		s->d_path = path;
+		try
+		{
+			s->d_db = new Database();
+			s->d_db->open( path );
+			if( cachePages > 0 )
+				s->d_db->setCacheSize( cachePages );
+			s->d_txn = new Transaction( s->d_db );
+			s->d_txn->setIndividualNotify(false);
+			return s;
+		}catch( DatabaseException& e )
+		{
+			delete s;
+			// Die Datei ist gesperrt, solange die GUI committed; kurz warten und nochmals versuchen.
+			// Fehlt die Datei oder ist sie kaputt, hilft Warten nicht.
+			if( !RepoSnapshot::isBusy( e ) || attempt >= s_busyRetries )
+			{
+				qWarning() << "Repository::openSnapshot" << path << e.getCodeString() << e.getMsg();
+				return 0;
+			}
+			QThread::msleep( s_busyWaitMs * ( attempt + 1 ) );
+		}
+	}
+}
+
+RepoSnapshot::~RepoSnapshot()
+{
+	if( d_txn )
+	{
+		d_txn->rollback(); // RISK: ein Snapshot schreibt nie
+		delete d_txn;
+	}
+	if( d_db )
+		delete d_db;
+}
+
+Udb::Obj RepoSnapshot::getRoot() const
+{
+	return d_txn->getObject( AppContext::s_rootUuid );
+}
+
+bool RepoSnapshot::isBusy(const DatabaseException& e)
+{
+	// Sqlite meldet SQLITE_BUSY bzw. SQLITE_LOCKED als "database is locked" bzw. "... busy"
+	const QString msg = e.getCodeString() + QLatin1Char(' ') + e.getMsg();
+	return msg.contains( QLatin1String("lock"), Qt::CaseInsensitive ) ||
+			msg.contains( QLatin1String("busy"), Qt::CaseInsensitive );
+}
+
+bool RepoSnapshot::retryAfterBusy(const DatabaseException& e, int attempt)
+{
+	if( !isBusy( e ) )
+	{
+		qWarning() << "RepoSnapshot" << d_path << e.getCodeString() << e.getMsg();
+		return false;
+	}
+	if( attempt >= s_busyRetries )
+		return false;
+	refresh();
+	QThread::msleep( s_busyWaitMs * ( attempt + 1 ) );
+	return true;
+}
+
+void RepoSnapshot::refresh()
+{
+	// Transaction hält gelesene Objekte im Cache; neu anlegen ist die einzige sichere Art, sie zu verwerfen.
+	if( d_txn )
+	{
+		d_txn->rollback();
+		delete d_txn;
+	}
+	d_txn = new Transaction( d_db );
+	d_txn->setIndividualNotify(false);
+}
+
+void Repository::addObserver(QObject* obj, const char* member, bool onTxn)
+{
+	_Observer o;
+	o.d_obj = obj;
+	o.d_member = member;
+	o.d_onTxn = onTxn;
+	d_observers.append( o );
+	attach( o, true );
+}
+
+void Repository::attach(const _Observer& o, bool on)
+{
+	if( o.d_onTxn )
+	{
+		if( on )
+			d_txn->addObserver( o.d_obj, o.d_member.constData(), false );
+		else
+			d_txn->removeObserver( o.d_obj, o.d_member.constData() );
+	}else
+	{
+		if( on )
+			d_db->addObserver( o.d_obj, o.d_member.constData(), false );
+		else
+			d_db->removeObserver( o.d_obj, o.d_member.constData() );
+	}
+}
+
+void Repository::beginBulkLoad()
+{
+	if( d_bulkLoad )
+		return;
+	d_bulkLoad = true;
+	d_bulkFirst = d_db->getMaxOid() + 1;
+	// Die Notifications werden erst beim commit verschickt; bis dahin die feinen Beobachter abhängen.
+	for( int i = 0; i < d_observers.size(); i++ )
+	{
+		if( !d_observers[i].d_obj.isNull() )
+			attach( d_observers[i], false );
+	}
+}
+
+void Repository::endBulkLoad(bool committed)
+{
+	if( !d_bulkLoad )
+		return;
+	d_bulkLoad = false;
+	for( int i = d_observers.size() - 1; i >= 0; i-- )
+	{
+		if( d_observers[i].d_obj.isNull() )
+			d_observers.removeAt( i );
+		else
+			attach( d_observers[i], true );
+	}
+	const Udb::OID last = d_db->getMaxOid();
+	if( committed && last >= d_bulkFirst )
+		emit sigBulkInserted( d_bulkFirst, last );
+}
+
+void Repository::rollback()
+{
+	if( d_txn == 0 )
+		return;
+	d_txn->rollback();
+	// Der Cache kann Werte enthalten, die nur in der verworfenen Arbeit standen
+	if( d_titles )
+		d_titles->clear();
+}
+
+static const int s_minCache = 2000; // Pages; entspricht etwa dem alten fixen Wert bei kleinen Dateien
+static const int s_defaultPageSize = 1024; // Sqlite 3.5
+
+int Repository::getCacheBudget(bool index)
+{
+	QSettings* set = AppContext::inst()->getSet();
+	if( index )
+		return set->value( "Cache/IndexBudgetMB", 64 ).toInt();
+	else
+		return set->value( "Cache/MainBudgetMB", 256 ).toInt();
+}
+
+int Repository::calcCacheSize(const QString& path, int budgetMb, bool fillBudget)
+{
+	// Der Cache soll die ganze Datei aufnehmen können, aber nicht mehr als das Budget belegen.
+	int pageSize = s_defaultPageSize;
+	QFile f( path );
+	if( f.open( QIODevice::ReadOnly ) )
+	{
+		// Sqlite Header: Page Size als Big Endian quint16 an Offset 16
+		const QByteArray h = f.read( 18 );
+		if( h.size() == 18 && h.startsWith( "SQLite format 3" ) )
+		{
+			const int ps = ( quint8( h[16] ) << 8 ) | quint8( h[17] );
+			if( ps >= 512 )
+				pageSize = ps;
+		}
+	}
+	const qint64 filePages = f.size() / pageSize;
+	const qint64 budgetPages = qint64( budgetMb ) * 1024 * 1024 / pageSize;
+	if( fillBudget )
+		return int( qMax( budgetPages, qint64( s_minCache ) ) );
+	qint64 res = qMin( filePages + filePages / 4, budgetPages ); // Reserve fürs Wachstum
+	if( res < s_minCache )
+		res = qMin( qint64( s_minCache ), qMax( budgetPages, qint64( 1 ) ) );
+	return int( res );
+}
+
+qint64 Repository::getFreeBytes(const QString& path)
+{
+	QFile f( path );
+	if( !f.open( QIODevice::ReadOnly ) )
+		return -1;
+	// Sqlite Header: Page Size an Offset 16, Anzahl Freelist Pages als Big Endian quint32 an Offset 36
+	const QByteArray h = f.read( 40 );
+	if( h.size() < 40 || !h.startsWith( "SQLite format 3" ) )
+		return -1;
+	int pageSize = ( quint8( h[16] ) << 8 ) | quint8( h[17] );
+	if( pageSize < 512 )
+		pageSize = s_defaultPageSize;
+	const quint32 freePages = ( quint32( quint8( h[36] ) ) << 24 ) | ( quint32( quint8( h[37] ) ) << 16 ) |
+		( quint32( quint8( h[38] ) ) << 8 ) | quint32( quint8( h[39] ) );
+	return qint64( freePages ) * pageSize;
+}
+
+qint64 Repository::timeScan(const QString& path)
+{
+	// Eigene Verbindung, damit der Cache der GUI nicht mitgemessen wird; der Page Cache des
+	// Betriebssystems bleibt aber warm, der Wert taugt nur zum Vergleich vorher/nachher.
+	if( !QFileInfo( path ).exists() )
+		return -1; // Udb würde die Datei anlegen
+	RepoSnapshot* snap = openSnapshot( path );
+	if( snap == 0 )
+		return -1;
+	QElapsedTimer timer;
+	timer.start();
+	qint64 res = -1;
+	try
+	{
+		RepoSnapshot::ReadGuard guard;
+		quint32 types = 0;
+		Udb::Extent e( snap->getTxn() );
+		if( e.first() ) do
+		{
+			types ^= e.getObj().getType();
+		}while( e.next() );
+		Q_UNUSED( types );
+		res = timer.elapsed();
+	}catch( DatabaseException& e )
+	{
+		qWarning() << "Repository::timeScan" << path << e.getCodeString() << e.getMsg();
+	}
+	delete snap;
+	return res;
+}
+
+void Repository::setCacheBudget(int mb)
+{
+	if( d_db == 0 )
+		return;
+	if( mb <= 0 )
+		mb = getCacheBudget( false );
+	d_cacheSize = calcCacheSize( d_db->getFilePath(), mb );
+	d_db->setCacheSize( d_cacheSize );
+}
@@ -21,25 +21,106 @@
 */
 
 #include <QObject>
+#include <QPointer>
 #include <Udb/Database.h>
 #include <Udb/Transaction.h>
+#include <Udb/UpdateInfo.h>
+
+namespace Udb
+{
+	class DatabaseException;
+}
 
 namespace Oln
 {
+	class AliasGraph;
+	class TitleCache;
+
+	// Nur-Lese-Sicht mit eigener Verbindung auf dieselbe Datei; sieht nur, was committed ist.
+	// Darf in einem Worker-Thread erzeugt und benutzt werden, aber immer nur von einem Thread.
+	// Lange Leser arbeiten in Etappen von ChunkSize Objekten und rufen dazwischen refresh() auf,
+	// damit die Lesesperre nicht die commits der GUI blockiert; nach einer DatabaseException
+	// wegen einer Sperre (z.B. weil die GUI gerade committed) mit retryAfterBusy() warten und die Etappe
+	// wiederholen; alle anderen Fehler werden nicht wiederholt.
+	// Jede Etappe in einem ReadGuard lesen: ein commit der GUI wartet, bis die laufenden Etappen fertig
+	// sind, und neue Etappen beginnen erst nach dem commit. Sqlite 3.5 kennt kein MVCC; ein Leser mit
+	// SHARED Lock liesse den commit sonst mit SQLITE_BUSY scheitern.
+	class RepoSnapshot
+	{
+	public:
+		enum { ChunkSize = 2000 };
+		class ReadGuard
+		{
+		public:
+			ReadGuard();
+			~ReadGuard();
+		};
+		~RepoSnapshot();
+		Udb::Transaction* getTxn() const { return d_txn; } // ändert bei refresh()
+		Udb::Obj getRoot() const;
+		const QString& getFilePath() const { return d_path; }
+		void refresh(); // verwirft gecachte Objekte, damit danach committete Änderungen sichtbar werden
+		// refresh() und warten; false, wenn e keine Sperre ist oder aufgegeben werden soll
+		bool retryAfterBusy( const Udb::DatabaseException& e, int attempt );
+		static bool isBusy( const Udb::DatabaseException& );
+	private:
+		friend class Repository;
+		RepoSnapshot():d_db(0),d_txn(0){}
+		Udb::Database* d_db;
+		Udb::Transaction* d_txn;
+		QString d_path;
+	};
+
     class Repository : public QObject
     {
+		Q_OBJECT
     public:
         explicit Repository(QObject *parent = 0);
         ~Repository();
 
         bool open( QString path );
         Udb::Transaction* getTxn() const { return d_txn; }
+		void setCacheBudget( int mb ); // 0..Default aus Settings
+		int getCacheSize() const { return d_cacheSize; }
+		static int getCacheBudget( bool index );
+		static int calcCacheSize( const QString& path, int budgetMb, bool fillBudget = false ); // in Pages
+		static qint64 getFreeBytes( const QString& path ); // Pages auf der Freelist, -1 falls kein Sqlite Header
+		static qint64 timeScan( const QString& path ); // ms für einen Durchgang über die Extent, -1 bei Fehler
 		Udb::Database* getDb() const;
 		const Udb::Obj& getRoot() const { return d_root; }
+		AliasGraph* getAliasGraph(); // in open() angelegt und aufgebaut
+		int prefetch( const Udb::Obj& oln ) const; // lädt die Items von oln in OID-Reihenfolge in den Cache
+		RepoSnapshot* createSnapshot() const; // Caller owns; 0 bei Fehler
+		static RepoSnapshot* openSnapshot( const QString& path, int cachePages = 0 ); // auch aus Worker-Threads
+		// Beobachter, die während einem Bulk Load keine einzelnen Notifications erhalten sollen; onTxn
+		// meldet auf der Transaction an, die auch PreCommit schickt (für Journale, die mitcommitted werden).
+		void addObserver( QObject*, const char* member, bool onTxn = false );
+		void beginBulkLoad();
+		void endBulkLoad( bool committed ); // nach commit bzw. rollback aufrufen
+		bool isBulkLoading() const { return d_bulkLoad; }
+		void rollback(); // die Transaction nur hierüber zurücksetzen
+	signals:
+		void sigBulkInserted( quint64 first, quint64 last ); // neu erzeugte OIDs, first..last
+	protected slots:
+		void onTxnUpdate( Udb::UpdateInfo );
+		void onCommitDone();
     private:
         Udb::Database* d_db;
 		Udb::Transaction* d_txn;
 		Udb::Obj d_root;
+		int d_cacheSize;
+		struct _Observer
+		{
+			QPointer<QObject> d_obj;
+			QByteArray d_member;
+			bool d_onTxn;
+		};
+		void attach( const _Observer&, bool on );
+		QList<_Observer> d_observers;
+		Udb::OID d_bulkFirst;
+		bool d_bulkLoad;
+		AliasGraph* d_aliasGraph;
+		TitleCache* d_titles;
 		// Root ist die Queue, in der alle Outlines chronologisch referenziert sind, und ebenso der Root des DocTrees.
     };
 }
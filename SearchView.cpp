@@ -75,7 +75,7 @@ SearchView::SearchView(Repository * doc, QWidget * p):QWidget( p ), d_doc( doc )
 {
 	setWindowTitle( tr("CrossLine Search") );
 
-	d_idx = new Indexer( d_doc->getTxn(), this );
+	d_idx = new Indexer( d_doc, this );
 
 	QVBoxLayout* vbox = new QVBoxLayout( this );
 	vbox->setMargin( 0 );
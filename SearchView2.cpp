@@ -21,6 +21,8 @@
 #include "TypeDefs.h"
 #include "Outliner.h"
 #include "Repository.h"
+#include "AppContext.h"
+#include "AliasGraph.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTreeWidget>
@@ -34,16 +36,27 @@
 #include <QSettings>
 #include <QResizeEvent>
 #include <QHeaderView>
+#include <QSplitter>
 #include <QProgressDialog>
 #include <QFileInfo>
+#include <QFile>
 #include <QDir>
 #include <QMimeData>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QListWidget>
+#include <QThread>
 #include <GuiTools/UiFunction.h>
 #include <Oln2/OutlineUdbMdl.h>
 #include <Oln2/OutlineItem.h>
 #include <Udb/Transaction.h>
 #include <Udb/Extent.h>
 #include <Udb/Database.h>
+#include <Udb/UpdateInfo.h>
+#include <Udb/Mit.h>
 #include <Fts/IndexEngine.h>
 #include <Fts/Tokenizer.h>
 #include <Fts/Stemmer.h>
@@ -51,8 +64,12 @@
 using namespace Oln;
 
 static const QUuid s_index = "{aa4374d8-ce71-4489-8a17-fd16b932dd28}";
+// Im Repository: Änderungen, solange der Index nicht offen ist; Schlüssel [oid] bzw. [first,last] nach Bulk Load
+static const QUuid s_journal = "{b05c3451-660c-4251-88d3-3c445568d6bb}";
 
 enum Cols { _Item, _Date, _Score };
+enum FacetRoles { _OutlineRole = Qt::UserRole + 1, _PeriodRole, _TitleRole, _KindRole, _KeyRole };
+enum FacetKind { _AllFacet, _OutlineFacet, _PeriodFacet, _TitleFacet, _BodyFacet };
 
 static QString _valuta( const Udb::Obj& o )
 {
@@ -64,6 +81,16 @@ static QString _valuta( const Udb::Obj& o )
 	else
 		return QString();
 }
+static QString _period( const Udb::Obj& o )
+{
+	Stream::DataCell v = o.getValue( AttrValuta );
+	if( !v.isDateTime() )
+		v = o.getValue( AttrCreatedOn );
+	if( v.isDateTime() )
+		return v.getDateTime().toString( "yyyy-MM" );
+	else
+		return QString();
+}
 static QString _scoreStr( const QVariant& v )
 {
 	return QString("%1").arg( v.toInt(), 8, 10, QLatin1Char('0') );
@@ -72,8 +99,18 @@ static QString _scoreStr( const QVariant& v )
 struct _SearchView2Item : public QTreeWidgetItem
 {
 	Oln::OutlineItem d_item;
-	_SearchView2Item( const Udb::Obj& item, QTreeWidget* w ):QTreeWidgetItem( w ),d_item(item) {}
-	_SearchView2Item( const Udb::Obj& item, QTreeWidgetItem* w ):QTreeWidgetItem( w ),d_item(item) {}
+	// Treffer aus anderen Repositories halten keine Obj, da das Repository vorher geschlossen werden kann
+	QString d_repo;
+	Udb::OID d_oid;
+	_SearchView2Item( const Udb::Obj& item, QTreeWidget* w ):QTreeWidgetItem( w ),d_item(item),d_oid(0) {}
+	_SearchView2Item( const Udb::Obj& item, QTreeWidgetItem* w ):QTreeWidgetItem( w ),d_item(item),d_oid(0) {}
+	_SearchView2Item( const QString& repo, const Udb::Obj& item, QTreeWidgetItem* w ):QTreeWidgetItem( w ),
+		d_repo(repo),d_oid(item.getOid())
+	{
+		setText( _Item, TypeDefs::formatObjectTitle( item ) );
+		setData( _Item, Qt::ToolTipRole, item.getString( AttrText ) );
+		setData( _Item, Qt::DecorationRole, Oln::OutlineUdbMdl::getPixmap( item.getType() ) );
+	}
 
 	bool operator<(const QTreeWidgetItem &other) const
 	{
@@ -91,6 +128,8 @@ struct _SearchView2Item : public QTreeWidgetItem
 	}
 	QVariant data(int column, int role) const
 	{
+		if( !d_repo.isEmpty() )
+			return QTreeWidgetItem::data( column, role );
 		if( role == Qt::ToolTipRole || role == Qt::DisplayRole )
 		{
 			switch( column )
@@ -126,43 +165,88 @@ static Udb::Obj _getDocument(const Udb::Obj & o)
 
 #define _separate_index_file_
 
-SearchView2::SearchView2(Outliner *parent) :
-	QWidget(parent),d_oln(parent)
+static const int s_topTerms = 20;
+
+static Fts::IndexEngine* _createEngine( const Udb::Obj& index, Udb::Transaction* txnDb, QObject* owner )
 {
-	Udb::Transaction* txnDb = d_oln->getDoc()->getTxn();
-	Udb::Obj index;
-#ifdef _separate_index_file_
-	try
+	Fts::IndexEngine::s_getDocument = _getDocument;
+	Fts::IndexEngine* idx = new Fts::IndexEngine(index, txnDb, owner);
+	idx->setTokenizer( new Fts::LetterOrNumberTok( idx ) );
+	idx->setStemmer( new Fts::GermanStemmer( idx ) );
+	idx->setStopper( new Fts::GermanStopper( idx ) );
+	idx->addAttrToWatch( Udb::ContentObject::AttrText );
+	idx->addAttrToWatch( Udb::ContentObject::AttrIdent );
+	// idx->useReverseIndex(true);
+	idx->resolveDocuments(true);
+	return idx;
+}
+
+// Führt eine Abfrage mit eigener Verbindung zum Repository und zur Index-Datei aus, damit bei
+// "All Repos." alle Repositories gleichzeitig gesucht werden können; Udb::Transaction und
+// Fts::IndexEngine der Fenster gehören dem GUI-Thread.
+class _SearchWorker : public QThread
+{
+public:
+	_SearchWorker( const QString& path, const QStringList& tokens, bool docAnd, bool itemAnd, bool fullMatch ):
+		d_path(path),d_tokens(tokens),d_docAnd(docAnd),d_itemAnd(itemAnd),d_fullMatch(fullMatch) {}
+	Fts::IndexEngine::DocHits d_res;
+	QString d_error;
+protected:
+	void run()
 	{
-		Udb::Database* db = new Udb::Database( this );
-		const QString path = getIndexPath( txnDb );
-		db->open( path );
-		db->setCacheSize( 10000 ); // RISK
-		Udb::Transaction* txn2 = new Udb::Transaction( db, this );
-		txn2->setIndividualNotify(false); // RISK
-		index = txn2->getObject( s_index );
-		if( index.isNull() )
+		RepoSnapshot* snap = Repository::openSnapshot( d_path );
+		if( snap == 0 )
 		{
-			index = txn2->createObject(s_index);
-			txn2->commit();
+			d_error = tr("cannot open '%1'").arg( d_path );
+			return;
 		}
-	}catch( std::exception& e )
+		Udb::Database* db = new Udb::Database( 0 );
+		try
+		{
+			db->open( getIndexPath() );
+			Udb::Transaction txn( db, 0 );
+			Udb::Obj index = txn.getObject( s_index );
+			if( !index.isNull() )
+			{
+				RepoSnapshot::ReadGuard guard;
+				Fts::IndexEngine* idx = _createEngine( index, snap->getTxn(), 0 );
+				d_res = idx->find( d_tokens, d_docAnd, d_itemAnd, true, !d_fullMatch );
+				delete idx;
+			}
+			txn.rollback();
+		}catch( std::exception& e )
+		{
+			d_error = QString::fromLatin1( e.what() );
+		}
+		delete db;
+		delete snap;
+	}
+	QString getIndexPath() const { return d_path + QLatin1String( ".index" ); } // siehe SearchView2::getIndexPath
+private:
+	QString d_path;
+	QStringList d_tokens;
+	bool d_docAnd;
+	bool d_itemAnd;
+	bool d_fullMatch;
+};
+
+SearchView2::SearchView2(Outliner *parent) :
+	QWidget(parent),d_oln(parent),d_idx(0),d_indexDb(0),d_indexTxn(0),d_lastQueryMs(-1),d_cachePages(0)
+{
+	d_changedSince = AppContext::inst()->getSet()->value( statsKey() + "ChangedSince" ).toUInt();
+	// Die Index-Datenbank wird erst in ensureIndex() geöffnet; bis dahin führt onTxnUpdate ein Journal
+	// im Repository, das mit der Änderung committed wird und darum auch einen Absturz übersteht.
+	Udb::Transaction* txn = d_oln->getDoc()->getTxn();
+	if( txn->getDb()->isReadOnly() )
+		d_journal = txn->getObject( s_journal );
+	else
 	{
-		QMessageBox::critical( 0, tr("Create/Open Index"), tr("Error: %1").arg( e.what() ) );
+		d_journal = txn->getOrCreateObject( s_journal );
+		txn->commit();
 	}
-#else
-	index = txnDb->getOrCreateObject( s_index );
-	txnDb->commit();
-#endif
-	Fts::IndexEngine::s_getDocument = _getDocument;
-	d_idx = new Fts::IndexEngine(index, txnDb, this);
-	d_idx->setTokenizer( new Fts::LetterOrNumberTok( d_idx ) );
-	d_idx->setStemmer( new Fts::GermanStemmer( d_idx ) );
-	d_idx->setStopper( new Fts::GermanStopper( d_idx ) );
-	d_idx->addAttrToWatch( Udb::ContentObject::AttrText );
-	d_idx->addAttrToWatch( Udb::ContentObject::AttrIdent );
-	// d_idx->useReverseIndex(true);
-	d_idx->resolveDocuments(true);
+	d_oln->getDoc()->addObserver( this, SLOT(onTxnUpdate( Udb::UpdateInfo ) ), true );
+	d_oln->getDoc()->addObserver( this, SLOT(onDbUpdate( Udb::UpdateInfo )) );
+	connect( d_oln->getDoc(), SIGNAL(sigBulkInserted(quint64,quint64)), this, SLOT(onBulkInserted(quint64,quint64)) );
 
 	QVBoxLayout* vbox = new QVBoxLayout( this );
 	vbox->setMargin( 0 );
@@ -199,12 +283,21 @@ SearchView2::SearchView2(Outliner *parent) :
 	connect( d_curDoc, SIGNAL(toggled(bool)),this,SLOT(doSearch()) );
 	hbox->addWidget( d_curDoc );
 
+	d_allRepos = new QCheckBox( tr("All Repos."), this );
+	d_allRepos->setToolTip( tr("Search all open repositories and group the hits by repository") );
+	d_allRepos->setChecked(false);
+	connect( d_allRepos, SIGNAL(toggled(bool)),this,SLOT(doSearch()) );
+	hbox->addWidget( d_allRepos );
+
 	QPushButton* doit = new QPushButton( tr("&Suchen"), this );
 	doit->setDefault(true);
 	connect( doit, SIGNAL( clicked() ), this, SLOT( doSearch() ) );
 	hbox->addWidget( doit );
 
-	d_result = new QTreeWidget( this );
+	QSplitter* split = new QSplitter( Qt::Horizontal, this );
+	vbox->addWidget( split );
+
+	d_result = new QTreeWidget( split );
 	d_result->header()->setStretchLastSection( false );
 	d_result->setAllColumnsShowFocus( true );
 	d_result->setRootIsDecorated( true );
@@ -217,7 +310,164 @@ SearchView2::SearchView2(Outliner *parent) :
 	d_result->setColumnWidth( _Date, 80 );
 	d_result->setColumnWidth( _Score, 40 );
 	connect( d_result, SIGNAL( itemDoubleClicked ( QTreeWidgetItem *, int ) ), this, SLOT( doGoto() ) );
-	vbox->addWidget( d_result );
+	split->addWidget( d_result );
+
+	d_facets = new QTreeWidget( split );
+	d_facets->header()->setStretchLastSection( false );
+	d_facets->setAllColumnsShowFocus( true );
+	d_facets->setHeaderLabels( QStringList() << tr("Filter") << tr("Hits") );
+	d_facets->header()->setSectionResizeMode( 0, QHeaderView::Stretch );
+	d_facets->setColumnWidth( 1, 40 );
+	d_facets->setToolTip( tr("Click to narrow the result list without repeating the query") );
+	connect( d_facets, SIGNAL( itemClicked(QTreeWidgetItem*,int) ), this, SLOT( onFacet(QTreeWidgetItem*) ) );
+	split->addWidget( d_facets );
+	split->setStretchFactor( 0, 4 );
+	split->setStretchFactor( 1, 1 );
+}
+
+bool SearchView2::ensureIndex()
+{
+	if( d_idx )
+		return true;
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	Udb::Transaction* txnDb = d_oln->getDoc()->getTxn();
+	Udb::Obj index;
+#ifdef _separate_index_file_
+	Udb::Database* db = new Udb::Database( this );
+	try
+	{
+		const QString path = getIndexPath( txnDb );
+		db->open( path );
+		d_indexDb = db;
+		setCacheBudget( 0 );
+		Udb::Transaction* txn2 = new Udb::Transaction( db, this );
+		txn2->setIndividualNotify(false); // RISK
+		d_indexTxn = txn2;
+		index = txn2->getObject( s_index );
+		if( index.isNull() )
+		{
+			index = txn2->createObject(s_index);
+			txn2->commit();
+		}
+	}catch( std::exception& e )
+	{
+		// Ohne Index-Objekt keine IndexEngine; das Journal bleibt für den nächsten Versuch erhalten
+		delete d_indexTxn;
+		d_indexTxn = 0;
+		delete db;
+		d_indexDb = 0;
+		QApplication::restoreOverrideCursor();
+		QMessageBox::critical( 0, tr("Create/Open Index"), tr("Error: %1").arg( e.what() ) );
+		return false;
+	}
+#else
+	index = txnDb->getOrCreateObject( s_index );
+	txnDb->commit();
+#endif
+	d_idx = _createEngine( index, txnDb, this );
+
+	// Was vor dem Öffnen geändert wurde, nachholen; von gelöschten Objekten die Postings entfernen,
+	// wie es die IndexEngine bei ObjectErased selber tut.
+	QList<Udb::Mit::KeyList> keys;
+	if( !d_journal.isNull() )
+	{
+		Udb::Mit mit = d_journal.findCells( Udb::Obj::KeyList() );
+		if( !mit.isNull() ) do
+		{
+			keys.append( mit.getKey() );
+		}while( mit.nextKey() );
+	}
+	foreach( const Udb::Mit::KeyList& k, keys )
+	{
+		if( k.isEmpty() || !k[0].isOid() )
+			continue;
+		const Udb::OID last = ( k.size() == 2 && k[1].isOid() ) ? k[1].getOid() : k[0].getOid();
+		for( Udb::OID oid = k[0].getOid(); oid <= last; oid++ )
+		{
+			Udb::Obj o = txnDb->getObject( oid );
+			if( !o.isNull() )
+				d_idx->indexObject( o, true );
+			else
+				d_idx->removeObject( oid );
+		}
+	}
+	if( !keys.isEmpty() )
+	{
+		d_idx->commit(true);
+		// Erst jetzt, da die Postings geschrieben sind, das Journal leeren
+		foreach( const Udb::Mit::KeyList& k, keys )
+			d_journal.setCell( k, Stream::DataCell().setNull() );
+		d_journal.commit();
+	}
+	QApplication::restoreOverrideCursor();
+	return true;
+}
+
+void SearchView2::closeIndex()
+{
+	// Ab jetzt sammelt onDbUpdate die Änderungen wieder im Journal
+	delete d_idx; // RISK: meldet sich als Beobachter der Repository-Datenbank selber ab
+	d_idx = 0;
+#ifdef _separate_index_file_
+	delete d_indexTxn;
+	d_indexTxn = 0;
+	delete d_indexDb;
+	d_indexDb = 0;
+#endif
+	d_hits.clear();
+	d_hitQuery.clear();
+}
+
+bool SearchView2::compactIndex()
+{
+#ifdef _separate_index_file_
+	// Udb gibt freie Pages nicht an das Dateisystem zurück und schreibt die Index-Einträge in der
+	// Reihenfolge der Objekte; eine neu aufgebaute Datei ist dicht und nach Schlüsseln geordnet.
+	// Die alte Datei bleibt bis zum Erfolg liegen.
+	const QString path = getIndexPath( d_oln->getDoc()->getTxn() );
+	const QString old = path + QLatin1String( ".old" );
+	closeIndex();
+	QFile::remove( old );
+	if( QFile::exists( path ) && !QFile::rename( path, old ) )
+	{
+		QMessageBox::critical( this, tr("Compact Index"), tr("cannot rename '%1'").arg( path ) );
+		return false;
+	}
+	if( rebuildIndex() )
+	{
+		QFile::remove( old );
+		return true;
+	}
+	closeIndex();
+	QFile::remove( path );
+	QFile::rename( old, path );
+	return false;
+#else
+	return rebuildIndex();
+#endif
+}
+
+void SearchView2::saveState()
+{
+	// Das Journal ist persistent und wird beim nächsten ensureIndex() nachgeholt; hier nichts öffnen
+	AppContext::inst()->getSet()->setValue( statsKey() + "ChangedSince", d_changedSince );
+}
+
+quint32 SearchView2::getJournalCount() const
+{
+	quint32 res = 0;
+	if( d_journal.isNull() )
+		return res;
+	Udb::Mit mit = d_journal.findCells( Udb::Obj::KeyList() );
+	if( !mit.isNull() ) do
+	{
+		const Udb::Mit::KeyList k = mit.getKey();
+		if( k.size() == 2 && k[0].isOid() && k[1].isOid() )
+			res += quint32( k[1].getOid() - k[0].getOid() + 1 );
+		else if( k.size() == 1 && k[0].isOid() )
+			res++;
+	}while( mit.nextKey() );
+	return res;
 }
 
 Udb::Obj SearchView2::getItem() const
@@ -226,7 +476,7 @@ Udb::Obj SearchView2::getItem() const
 	if( cur == 0 )
 		return Udb::Obj();
 	else
-		return d_idx->getTxn()->getObject( cur->data( 0,Qt::UserRole).toULongLong() );
+		return d_oln->getDoc()->getTxn()->getObject( cur->data( 0,Qt::UserRole).toULongLong() );
 }
 
 QStringList SearchView2::tokenize(const QString & s)
@@ -270,23 +520,12 @@ QString SearchView2::getIndexPath(Udb::Transaction *txn)
 	return txn->getDb()->getFilePath() + QLatin1String( ".index" );
 }
 
-void SearchView2::doSearch()
+bool SearchView2::queryTokens(QStringList& tokens)
 {
-	if( d_idx->isEmpty() )
-	{
-		if( QMessageBox::question( this, tr("CrossLine Search"),
-			tr("The index is empty. Do you want to create it? This will take some minutes." ),
-			QMessageBox::Ok | QMessageBox::Cancel ) == QMessageBox::Cancel )
-			return;
-		if( !rebuildIndex() )
-		{
-			return;
-		}
-	}
 	const QString title = tr("Checking Query Terms - CrossLine");
 	const QChar star('*');
 	const QChar shout('!');
-	QStringList tokens = tokenize( d_query->text() );
+	tokens = tokenize( d_query->text() );
 	for( int i = 0; i < tokens.size(); i++ )
 	{
 		QString& t = tokens[i];
@@ -296,7 +535,7 @@ void SearchView2::doSearch()
 			if( starCount > 1 || ( starCount != 0 && ! t.endsWith( star )) || t.contains(shout) || t == star )
 			{
 				QMessageBox::information( this, title, tr("Only one terminating wildcard per term supported.") );
-				return;
+				return false;
 			}
 		}else
 		{
@@ -304,37 +543,206 @@ void SearchView2::doSearch()
 			if( shoutCount > 1 || ( shoutCount != 0 && ! t.endsWith( shout )) || t.contains(star) || t == shout )
 			{
 				QMessageBox::information( this, title, tr("Only one terminating exlamation mark per term supported.") );
-				return;
+				return false;
 			}
 			t.replace( shout, star );
 		}
 	}
+	return true;
+}
+
+void SearchView2::doSearch()
+{
+	if( !ensureIndex() )
+		return;
+	if( d_idx->isEmpty() )
+	{
+		if( QMessageBox::question( this, tr("CrossLine Search"),
+			tr("The index is empty. Do you want to create it? This will take some minutes." ),
+			QMessageBox::Ok | QMessageBox::Cancel ) == QMessageBox::Cancel )
+			return;
+		if( !rebuildIndex() )
+		{
+			return;
+		}
+	}
+	QStringList tokens;
+	if( !queryTokens( tokens ) )
+		return;
 
-	Fts::IndexEngine::DocHits res = d_idx->find( tokens, d_docAnd->isChecked(), d_itemAnd->isChecked(),
-												 true, !d_fullMatch->isChecked() );
+	QElapsedTimer timer;
+	timer.start();
 	d_result->clear();
+	Facets facets;
+
+	if( !d_allRepos->isChecked() )
+	{
+		fillResult( this, d_idx->find( tokens, d_docAnd->isChecked(), d_itemAnd->isChecked(),
+									   true, !d_fullMatch->isChecked() ), 0, facets );
+		d_lastQueryMs = timer.elapsed();
+		fillFacets( facets );
+		d_result->expandAll();
+		return;
+	}
+
+	// Die Indizes zuerst hier öffnen; ensureIndex kann eine Meldung zeigen, darum noch ohne Wait Cursor.
+	// Danach sucht jedes Repository in einem eigenen Thread, die Treffer werden hier zusammengeführt.
+	const QList<Outliner*> olns = AppContext::inst()->getOutliners();
+	QList<_SearchWorker*> workers;
+	foreach( Outliner* o, olns )
+	{
+		SearchView2* sv = o->getSearch();
+		_SearchWorker* w = 0;
+		if( sv->ensureIndex() && !sv->d_idx->isEmpty() )
+		{
+			sv->d_idx->commit(true);
+			w = new _SearchWorker( o->getDoc()->getDb()->getFilePath(), tokens,
+								   d_docAnd->isChecked(), d_itemAnd->isChecked(), d_fullMatch->isChecked() );
+		}
+		workers.append( w );
+	}
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	foreach( _SearchWorker* w, workers )
+		if( w )
+			w->start();
+	foreach( _SearchWorker* w, workers )
+		if( w )
+			w->wait();
+	QApplication::restoreOverrideCursor();
+	for( int i = 0; i < olns.size(); i++ )
+	{
+		Outliner* o = olns[i];
+		_SearchWorker* w = workers[i];
+		QTreeWidgetItem* repo = new QTreeWidgetItem( d_result );
+		const QFileInfo info( o->getDoc()->getDb()->getFilePath() );
+		repo->setText( _Item, info.completeBaseName() );
+		repo->setToolTip( _Item, info.absoluteFilePath() );
+		if( w == 0 )
+		{
+			repo->setText( _Date, tr("no index") );
+			continue;
+		}
+		if( !w->d_error.isEmpty() )
+		{
+			repo->setText( _Date, tr("error") );
+			repo->setToolTip( _Date, w->d_error );
+		}else
+		{
+			fillResult( o->getSearch(), w->d_res, repo, facets );
+			repo->setData( _Score, Qt::DisplayRole, repo->childCount() );
+		}
+		delete w;
+	}
+	d_lastQueryMs = timer.elapsed();
+	fillFacets( facets );
+	d_result->expandAll();
+}
 
+struct _DocEntry
+{
+	int d_rank;
+	QList< QPair<Udb::OID,int> > d_items;
+	_DocEntry():d_rank(0) {}
+};
+
+void SearchView2::fillResult(SearchView2* sv, const Fts::IndexEngine::DocHits& res, QTreeWidgetItem* repo,
+							 Facets& facets)
+{
+	const bool foreign = sv != this;
+	Udb::Transaction* txn = sv->d_idx->getTxn();
+	const QString path = txn->getDb()->getFilePath();
+	AliasGraph* graph = sv->d_oln->getDoc()->getAliasGraph();
+
+	// Der Body von Aliassen ist nur beim Original indiziert; die Treffer werden hier auf die Aliasse
+	// ausgedehnt, auch Aliasse von Aliassen, die in anderen Outlines liegen können.
+	QList<Udb::OID> order;
+	QHash<Udb::OID,_DocEntry> docs;
 	for( int i = 0; i < res.size(); i++ )
 	{
-		Udb::Obj doc = d_idx->getTxn()->getObject( res[i].d_doc );
-		if( !d_curDoc->isChecked() || d_oln->currentDoc().equals(doc) )
+		if( !docs.contains( res[i].d_doc ) )
+			order.append( res[i].d_doc );
+		_DocEntry& e = docs[ res[i].d_doc ];
+		e.d_rank = qMax( e.d_rank, int( res[i].d_rank ) );
+		foreach( const Fts::IndexEngine::ItemHit& h, res[i].d_items )
 		{
-			_SearchView2Item* p = new _SearchView2Item( doc, d_result );
-			p->setData( _Score, Qt::DisplayRole, res[i].d_rank );
+			e.d_items.append( qMakePair( h.d_item, int( h.d_rank ) ) );
+			foreach( Udb::OID aliasId, graph->closure( h.d_item ) )
+			{
+				Udb::Obj alias = txn->getObject( aliasId );
+				if( alias.isNull() )
+					continue;
+				const Udb::OID home = alias.getValue( AttrItemHome ).getOid();
+				if( home == 0 )
+					continue;
+				if( !docs.contains( home ) )
+					order.append( home );
+				_DocEntry& ae = docs[ home ];
+				ae.d_rank = qMax( ae.d_rank, int( h.d_rank ) );
+				ae.d_items.append( qMakePair( alias.getOid(), int( h.d_rank ) ) );
+			}
+		}
+	}
+
+	foreach( Udb::OID docId, order )
+	{
+		const _DocEntry& e = docs[ docId ];
+		Udb::Obj doc = txn->getObject( docId );
+		if( doc.isNull() )
+			continue;
+		if( foreign || !d_curDoc->isChecked() || d_oln->currentDoc().equals(doc) )
+		{
+			_SearchView2Item* p;
+			if( foreign )
+				p = new _SearchView2Item( path, doc, repo );
+			else if( repo )
+				p = new _SearchView2Item( doc, repo );
+			else
+				p = new _SearchView2Item( doc, d_result );
+			p->setData( _Score, Qt::DisplayRole, e.d_rank );
 			p->setText( _Date, _valuta( doc ) );
+
+			// Die Facetten werden im selben Durchgang wie die Trefferliste erhoben
+			const QString olnKey = QString("%1#%2").arg( path ).arg( doc.getOid() );
+			const QString period = _period( doc );
+			const int hits = qMax( 1, e.d_items.size() );
+			p->setData( _Item, _OutlineRole, olnKey );
+			p->setData( _Item, _PeriodRole, period );
+			QPair<QString,int>& oc = facets.d_outlines[olnKey];
+			if( oc.first.isEmpty() )
+				oc.first = TypeDefs::prettyTitle( doc, false );
+			oc.second += hits;
+			if( !period.isEmpty() )
+			{
+				facets.d_periods[period.left(4)] += hits;
+				facets.d_periods[period] += hits;
+			}
+			if( e.d_items.isEmpty() )
+				facets.d_titles++;
+
             QSize s = p->sizeHint(0);
             s.setHeight( s.height() * 1.3);
             p->setSizeHint(0,s);
-            foreach( const Fts::IndexEngine::ItemHit& h, res[i].d_items )
+			for( int j = 0; j < e.d_items.size(); j++ )
 			{
-				Udb::Obj o = d_idx->getTxn()->getObject( h.d_item );
-				_SearchView2Item* i = new _SearchView2Item( o, p );
+				Udb::Obj o = txn->getObject( e.d_items[j].first );
+				if( o.isNull() )
+					continue; // erst nach dem letzten Index-Update gelöscht
+				_SearchView2Item* i;
+				if( foreign )
+					i = new _SearchView2Item( path, o, p );
+				else
+					i = new _SearchView2Item( o, p );
                 i->setSizeHint( 0, s );
-				i->setData( _Score, Qt::DisplayRole, h.d_rank );
+				i->setData( _Score, Qt::DisplayRole, e.d_items[j].second );
+				const bool isTitle = o.getValue( AttrItemIsTitle ).getBool();
+				i->setData( _Item, _TitleRole, isTitle );
+				if( isTitle )
+					facets.d_titles++;
+				else
+					facets.d_bodies++;
 			}
 		}
 	}
-	d_result->expandAll();
 }
 
 void SearchView2::doNew()
@@ -355,14 +763,15 @@ void SearchView2::onClearSearch()
 	ENABLED_IF( d_result->topLevelItemCount() > 0 );
 
 	d_result->clear();
+	d_facets->clear();
 	d_query->clear();
 	d_query->setFocus();
 }
 
 void SearchView2::onCopyRef()
 {
-	ENABLED_IF( d_result->currentItem() );
-	_SearchView2Item* item = static_cast<_SearchView2Item*>( d_result->currentItem() );
+	_SearchView2Item* item = dynamic_cast<_SearchView2Item*>( d_result->currentItem() );
+	ENABLED_IF( item && !item->d_item.isNull() );
 	QMimeData* mimeData = new QMimeData();
 	QList<Udb::Obj> objs;
 	objs.append( item->d_item );
@@ -371,17 +780,51 @@ void SearchView2::onCopyRef()
 
 void SearchView2::doGoto()
 {
-	QTreeWidgetItem* cur = d_result->currentItem();
-	ENABLED_IF( cur );
-	_SearchView2Item* item = static_cast<_SearchView2Item*>( d_result->currentItem() );
-	if( !item->d_item.isNull() && !item->d_item.isErased() )
+	_SearchView2Item* item = dynamic_cast<_SearchView2Item*>( d_result->currentItem() );
+	ENABLED_IF( item );
+	if( !item->d_repo.isEmpty() )
+	{
+		// Dasselbe Format wie auf der Kommandozeile bzw. bei QtSingleApplication::sendMessage
+		AppContext::inst()->open( QString("\"%1\" -oid:%2").arg( item->d_repo ).arg( item->d_oid ) );
+	}else if( !item->d_item.isNull() && !item->d_item.isErased() )
 		emit sigFollow( item->d_item.getOid() );
 }
 
+static void _countTerms( const Udb::Obj& obj, QHash<QString,quint32>& terms, quint32& postings, quint32& docs )
+{
+	// Näherung an die Terme der IndexEngine; ohne Stemmer und Stopper
+	QStringList toks = SearchView2::tokenize( obj.getString( AttrText, true ) + QChar(' ') +
+											  obj.getString( AttrIdent, true ) );
+	if( toks.isEmpty() )
+		return;
+	docs++;
+	QSet<QString> seen;
+	foreach( const QString& t, toks )
+	{
+		const QString term = t.toLower();
+		if( seen.contains( term ) )
+			continue;
+		seen.insert( term );
+		terms[term]++;
+		postings++;
+	}
+}
+
 bool SearchView2::rebuildIndex()
 {
+	if( !ensureIndex() )
+		return false;
+	QElapsedTimer timer;
+	timer.start();
 	d_idx->clearIndex();
 
+	// Während dem Rebuild wird die Index-Datenbank zufällig beschrieben, darum das ganze Budget
+	// unabhängig von der aktuellen Dateigrösse nutzen.
+	const int oldCache = d_cachePages;
+	if( d_indexDb )
+		d_indexDb->setCacheSize( qMax( oldCache, Repository::calcCacheSize( d_indexDb->getFilePath(),
+			Repository::getCacheBudget( true ), true ) ) );
+
 	QProgressDialog progress( tr("Indexing repository..."), tr("Abort"), 0,
 		d_idx->getTxn()->getDb()->getMaxOid(), this );
 	progress.setMinimumDuration( 0 );
@@ -399,20 +842,169 @@ bool SearchView2::rebuildIndex()
 		if( progress.wasCanceled() )
 		{
 			d_idx->clearIndex();
+			setCacheBudget( 0 );
 			return false;
 		}
 	}while( e.next() );
 	progress.setValue( d_idx->getTxn()->getDb()->getMaxOid() );
 	d_idx->commit(true);
+	setCacheBudget( 0 ); // an die neue Dateigrösse anpassen
 	// d_idx->test(); //  TEST
+
+	QSettings* set = AppContext::inst()->getSet();
+	const QString key = statsKey();
+	set->setValue( key + "LastRebuild", QDateTime::currentDateTime() );
+	set->setValue( key + "RebuildMs", timer.elapsed() );
+	return true;
+}
+
+bool SearchView2::countTerms()
+{
+	// Die Term-Zahlen kosten einen eigenen Durchgang; darum nur auf Verlangen im Statistik-Dialog
+	// und nicht bei jedem Rebuild. Wie alt sie sind, zeigt d_changedSince.
+	Udb::Transaction* txn = d_oln->getDoc()->getTxn();
+	QProgressDialog progress( tr("Counting terms..."), tr("Abort"), 0, txn->getDb()->getMaxOid(), this );
+	progress.setMinimumDuration( 0 );
+	progress.setWindowTitle( tr( "CrossLine Index" ) );
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setAutoClose( true );
+
+	QHash<QString,quint32> terms;
+	quint32 postings = 0;
+	quint32 docs = 0;
+	Udb::Extent e( txn );
+	if( e.first() ) do
+	{
+		Udb::Obj obj = e.getObj();
+		_countTerms( obj, terms, postings, docs );
+		progress.setValue( obj.getOid() );
+		QApplication::processEvents();
+		if( progress.wasCanceled() )
+			return false;
+	}while( e.next() );
+	progress.setValue( txn->getDb()->getMaxOid() );
+
+	QMultiMap<quint32,QString> byCount;
+	QHash<QString,quint32>::const_iterator i;
+	for( i = terms.begin(); i != terms.end(); ++i )
+	{
+		byCount.insert( i.value(), i.key() );
+		if( byCount.size() > s_topTerms )
+			byCount.erase( byCount.begin() );
+	}
+	QStringList top;
+	QMultiMap<quint32,QString>::const_iterator j = byCount.end();
+	while( j != byCount.begin() )
+	{
+		--j;
+		top.append( QString("%1\t%2").arg( j.value() ).arg( j.key() ) );
+	}
+	QSettings* set = AppContext::inst()->getSet();
+	const QString key = statsKey();
+	set->setValue( key + "Terms", terms.size() );
+	set->setValue( key + "Postings", postings );
+	set->setValue( key + "Docs", docs );
+	set->setValue( key + "TopTerms", top );
+	set->setValue( key + "Counted", QDateTime::currentDateTime() );
+	d_changedSince = 0;
+	set->setValue( key + "ChangedSince", d_changedSince );
 	return true;
 }
 
+QString SearchView2::statsKey() const
+{
+	return QString("IndexStats/%1/").arg( d_oln->getDoc()->getDb()->getDbUuid().toString() );
+}
+
+SearchView2::IndexStats SearchView2::getStats() const
+{
+	IndexStats s;
+	s.d_fileSize = QFileInfo( getIndexPath( d_oln->getDoc()->getTxn() ) ).size();
+	QSettings* set = AppContext::inst()->getSet();
+	const QString key = statsKey();
+	s.d_terms = set->value( key + "Terms" ).toUInt();
+	s.d_postings = set->value( key + "Postings" ).toUInt();
+	s.d_docs = set->value( key + "Docs" ).toUInt();
+	s.d_topTerms = set->value( key + "TopTerms" ).toStringList();
+	s.d_counted = set->value( key + "Counted" ).toDateTime();
+	s.d_changedSince = d_changedSince;
+	s.d_lastRebuild = set->value( key + "LastRebuild" ).toDateTime();
+	s.d_rebuildMs = set->value( key + "RebuildMs", -1 ).toLongLong();
+	s.d_queryMs = d_lastQueryMs;
+	s.d_pending = getJournalCount();
+	s.d_cachePages = d_cachePages;
+	return s;
+}
+
+void SearchView2::setCacheBudget(int mb)
+{
+	if( d_indexDb == 0 )
+		return;
+	if( mb <= 0 )
+		mb = Repository::getCacheBudget( true );
+	d_cachePages = Repository::calcCacheSize( d_indexDb->getFilePath(), mb );
+	d_indexDb->setCacheSize( d_cachePages );
+}
+
+void SearchView2::onShowStats()
+{
+	ENABLED_IF(true);
+
+	while( showStats() )
+		countTerms();
+}
+
+bool SearchView2::showStats()
+{
+	const IndexStats s = getStats();
+	QDialog dlg( this );
+	dlg.setWindowTitle( tr("Index Statistics - CrossLine") );
+	QVBoxLayout* vbox = new QVBoxLayout( &dlg );
+	QFormLayout* form = new QFormLayout();
+	vbox->addLayout( form );
+	const QString unknown = tr("<unknown>");
+	form->addRow( tr("Index file:"), new QLabel( getIndexPath( d_oln->getDoc()->getTxn() ), &dlg ) );
+	form->addRow( tr("Size on disk:"), new QLabel( tr("%1 KB").arg( s.d_fileSize / 1024 ), &dlg ) );
+	form->addRow( tr("Index empty:"), new QLabel( ( d_idx == 0 ) ? tr("not opened yet") :
+		d_idx->isEmpty() ? tr("yes") : tr("no"), &dlg ) );
+	form->addRow( tr("Last rebuild:"), new QLabel( s.d_lastRebuild.isValid() ?
+		s.d_lastRebuild.toString( "yyyy-MM-dd hh:mm" ) : unknown, &dlg ) );
+	form->addRow( tr("Rebuild time:"), new QLabel( ( s.d_rebuildMs < 0 ) ? unknown :
+		tr("%1 s").arg( s.d_rebuildMs / 1000.0, 0, 'f', 1 ), &dlg ) );
+	form->addRow( tr("Last query:"), new QLabel( ( s.d_queryMs < 0 ) ? unknown :
+		tr("%1 ms").arg( s.d_queryMs ), &dlg ) );
+	form->addRow( tr("Cache:"), new QLabel( tr("%1 pages index, %2 pages repository").
+		arg( s.d_cachePages ).arg( d_oln->getDoc()->getCacheSize() ), &dlg ) );
+	form->addRow( tr("Pending updates:"), new QLabel( QString::number( s.d_pending ), &dlg ) );
+	form->addRow( tr("Terms counted:"), new QLabel( !s.d_counted.isValid() ? tr("never") :
+		tr("%1, %2 objects changed since").arg( s.d_counted.toString( "yyyy-MM-dd hh:mm" ) )
+		.arg( s.d_changedSince ), &dlg ) );
+	form->addRow( tr("Indexed objects:"), new QLabel( QString::number( s.d_docs ), &dlg ) );
+	form->addRow( tr("Terms:"), new QLabel( QString::number( s.d_terms ), &dlg ) );
+	form->addRow( tr("Postings:"), new QLabel( QString::number( s.d_postings ), &dlg ) );
+	form->addRow( tr("Avg. posting length:"), new QLabel( QString::number( s.avgPostingLen(), 'f', 1 ), &dlg ) );
+	QListWidget* top = new QListWidget( &dlg );
+	foreach( const QString& t, s.d_topTerms )
+		top->addItem( QString( t ).replace( QChar('\t'), QLatin1String("  ") ) );
+	form->addRow( tr("Most frequent terms:"), top );
+	QLabel* note = new QLabel( tr("Term counts are approximate (without stemming) and are not updated "
+								  "with the index; use Recount to refresh them."), &dlg );
+	note->setWordWrap( true );
+	vbox->addWidget( note );
+	QDialogButtonBox* bb = new QDialogButtonBox( QDialogButtonBox::Close, Qt::Horizontal, &dlg );
+	QPushButton* recount = bb->addButton( tr("Recount"), QDialogButtonBox::ActionRole );
+	vbox->addWidget( bb );
+	connect( bb, SIGNAL(rejected()), &dlg, SLOT(reject()) );
+	connect( recount, SIGNAL(clicked()), &dlg, SLOT(accept()) );
+	return dlg.exec() == QDialog::Accepted;
+}
+
 void SearchView2::onTest()
 {
 #ifdef _DEBUG
 	ENABLED_IF(true);
-	d_idx->test();
+	if( ensureIndex() )
+		d_idx->test();
 #endif
 }
 
@@ -427,3 +1019,233 @@ void SearchView2::onOpenAll()
 	ENABLED_IF(true);
 	d_result->expandAll();
 }
+
+static QTreeWidgetItem* _facet( QTreeWidgetItem* p, const QString& text, int hits, int kind, const QString& key )
+{
+	QTreeWidgetItem* f = new QTreeWidgetItem( p );
+	f->setText( 0, text );
+	f->setData( 1, Qt::DisplayRole, hits );
+	f->setData( 0, _KindRole, kind );
+	f->setData( 0, _KeyRole, key );
+	return f;
+}
+
+void SearchView2::fillFacets(const Facets& facets)
+{
+	d_facets->clear();
+	if( d_result->topLevelItemCount() == 0 )
+		return;
+
+	QTreeWidgetItem* all = new QTreeWidgetItem( d_facets );
+	all->setText( 0, tr("(all)") );
+	all->setData( 1, Qt::DisplayRole, facets.d_titles + facets.d_bodies );
+	all->setData( 0, _KindRole, _AllFacet );
+
+	QTreeWidgetItem* kind = new QTreeWidgetItem( d_facets );
+	kind->setText( 0, tr("Hit kind") );
+	_facet( kind, tr("Titles"), facets.d_titles, _TitleFacet, QString() );
+	_facet( kind, tr("Bodies"), facets.d_bodies, _BodyFacet, QString() );
+
+	QTreeWidgetItem* periods = new QTreeWidgetItem( d_facets );
+	periods->setText( 0, tr("Valid") );
+	QTreeWidgetItem* year = 0;
+	QMap<QString,int>::const_iterator i;
+	for( i = facets.d_periods.begin(); i != facets.d_periods.end(); ++i )
+	{
+		if( i.key().size() == 4 )
+			year = _facet( periods, i.key(), i.value(), _PeriodFacet, i.key() );
+		else if( year )
+			_facet( year, i.key(), i.value(), _PeriodFacet, i.key() );
+	}
+
+	QTreeWidgetItem* outlines = new QTreeWidgetItem( d_facets );
+	outlines->setText( 0, tr("Outlines") );
+	QMap<QString,QPair<QString,int> >::const_iterator j;
+	for( j = facets.d_outlines.begin(); j != facets.d_outlines.end(); ++j )
+		_facet( outlines, j.value().first, j.value().second, _OutlineFacet, j.key() );
+	outlines->sortChildren( 1, Qt::DescendingOrder );
+
+	kind->setExpanded( true );
+	periods->setExpanded( true );
+	outlines->setExpanded( true );
+}
+
+void SearchView2::onFacet(QTreeWidgetItem* f)
+{
+	if( f == 0 || f->data( 0, _KindRole ).isNull() )
+		return;
+	applyFacet( f->data( 0, _KindRole ).toInt(), f->data( 0, _KeyRole ).toString() );
+}
+
+static void _applyFacet( QTreeWidgetItem* doc, int kind, const QString& key )
+{
+	// Jede Facette ersetzt die vorherige; was Titles bzw. Bodies versteckt hat, wieder zeigen
+	for( int i = 0; i < doc->childCount(); i++ )
+		doc->child( i )->setHidden( false );
+	bool visi = true;
+	switch( kind )
+	{
+	case _OutlineFacet:
+		visi = doc->data( _Item, _OutlineRole ).toString() == key;
+		break;
+	case _PeriodFacet:
+		visi = doc->data( _Item, _PeriodRole ).toString().startsWith( key );
+		break;
+	case _TitleFacet:
+	case _BodyFacet:
+		{
+			const bool wantTitle = kind == _TitleFacet;
+			int shown = 0;
+			for( int i = 0; i < doc->childCount(); i++ )
+			{
+				QTreeWidgetItem* item = doc->child( i );
+				const bool match = item->data( _Item, _TitleRole ).toBool() == wantTitle;
+				item->setHidden( !match );
+				if( match )
+					shown++;
+			}
+			visi = shown > 0 || ( wantTitle && doc->childCount() == 0 );
+		}
+		break;
+	default:
+		break;
+	}
+	doc->setHidden( !visi );
+}
+
+void SearchView2::applyFacet(int kind, const QString& key)
+{
+	for( int i = 0; i < d_result->topLevelItemCount(); i++ )
+	{
+		QTreeWidgetItem* top = d_result->topLevelItem( i );
+		if( top->data( _Item, _OutlineRole ).isNull() )
+		{
+			// Repository-Gruppe
+			int shown = 0;
+			for( int j = 0; j < top->childCount(); j++ )
+			{
+				_applyFacet( top->child( j ), kind, key );
+				if( !top->child( j )->isHidden() )
+					shown++;
+			}
+			top->setHidden( shown == 0 && top->childCount() > 0 );
+		}else
+			_applyFacet( top, kind, key );
+	}
+}
+
+Udb::Obj SearchView2::findNext(const Udb::Obj& cur, bool forward)
+{
+	if( cur.isNull() || d_query->text().simplified().isEmpty() || !ensureIndex() || d_idx->isEmpty() )
+		return Udb::Obj();
+	Udb::Obj doc = cur;
+	if( cur.getType() == TypeOutlineItem )
+		doc = cur.getValueAsObj( AttrItemHome );
+	if( doc.isNull() )
+		return Udb::Obj();
+
+	const QString query = QString("%1%2%3 %4").arg( d_fullMatch->isChecked() ).arg( d_docAnd->isChecked() ).
+			arg( d_itemAnd->isChecked() ).arg( d_query->text().simplified() );
+	if( !d_order.getDoc().equals( doc ) )
+	{
+		d_order.setDoc( doc );
+		d_hitQuery.clear();
+	}
+	if( d_hitQuery != query )
+	{
+		// Treffer nur einmal pro Query und Outline abfragen und in Dokumentreihenfolge sortieren
+		QStringList tokens;
+		if( !queryTokens( tokens ) )
+			return Udb::Obj();
+		d_hits.clear();
+		AliasGraph* graph = d_oln->getDoc()->getAliasGraph();
+		Fts::IndexEngine::DocHits res = d_idx->find( tokens, d_docAnd->isChecked(), d_itemAnd->isChecked(),
+													 true, !d_fullMatch->isChecked() );
+		for( int i = 0; i < res.size(); i++ )
+		{
+			if( res[i].d_doc == doc.getOid() && res[i].d_items.isEmpty() )
+				d_hits[0] = doc.getOid();
+			foreach( const Fts::IndexEngine::ItemHit& h, res[i].d_items )
+			{
+				const qint32 pos = d_order.getPos( h.d_item );
+				if( pos >= 0 )
+					d_hits[pos] = h.d_item;
+				// Aliasse im aktuellen Outline, deren Original anderswo liegt
+				foreach( Udb::OID alias, graph->closure( h.d_item ) )
+				{
+					const qint32 apos = d_order.getPos( alias );
+					if( apos >= 0 )
+						d_hits[apos] = alias;
+				}
+			}
+		}
+		d_hitQuery = query;
+	}
+	const Udb::OID oid = DocOrder::seek( d_hits, d_order.getPos( cur.getOid() ), forward );
+	if( oid == 0 )
+		return Udb::Obj();
+	else
+		return d_idx->getTxn()->getObject( oid );
+}
+
+void SearchView2::onBulkInserted(quint64 first, quint64 last)
+{
+	d_changedSince += quint32( last - first + 1 );
+	d_order.clear();
+	d_hits.clear();
+	d_hitQuery.clear();
+	if( d_idx != 0 || d_journal.isNull() )
+		return; // die IndexEngine hat die Änderungen beim commit selber gesehen
+	// Ein Eintrag für den ganzen Bereich statt einer pro Objekt
+	Udb::Obj::KeyList k(2);
+	k[0].setOid( first );
+	k[1].setOid( last );
+	d_journal.setCell( k, Stream::DataCell().setBool( true ) );
+	d_journal.commit();
+}
+
+void SearchView2::onTxnUpdate(Udb::UpdateInfo info)
+{
+	// Wie BackRefJob::onDbUpdate; während Bulk Loads abgehängt, die kommen als Bereich über onBulkInserted
+	if( info.d_kind != Udb::UpdateInfo::PreCommit || d_idx != 0 || d_journal.isNull() )
+		return;
+	// Kopie, da setCell die Notification List ergänzt
+	QList<Udb::UpdateInfo> updates = d_journal.getTxn()->getPendingNotifications();
+	Udb::Obj::KeyList k(1);
+	for( int i = 0; i < updates.size(); i++ )
+	{
+		const Udb::UpdateInfo& upd = updates[i];
+		if( ( upd.d_kind == Udb::UpdateInfo::ValueChanged && ( upd.d_name == AttrText || upd.d_name == AttrIdent ) ) ||
+				upd.d_kind == Udb::UpdateInfo::ObjectErased )
+		{
+			k[0].setOid( upd.d_id );
+			if( d_journal.getCell( k ).isNull() )
+				d_journal.setCell( k, Stream::DataCell().setBool( true ) );
+			// NOTE: kein commit, da in Pre-Commit der Transaction, wo die Änderung stattfand
+		}
+	}
+}
+
+void SearchView2::onDbUpdate(Udb::UpdateInfo info)
+{
+	// Struktur oder Text kann geändert haben; Reihenfolge und Treffer beim nächsten findNext neu bestimmen
+	if( !d_order.isEmpty() )
+	{
+		d_order.clear();
+		d_hits.clear();
+		d_hitQuery.clear();
+	}
+	// Das Journal führt onTxnUpdate; hier nur zählen, wie alt die Statistik ist
+	switch( info.d_kind )
+	{
+	case Udb::UpdateInfo::ValueChanged:
+		if( info.d_name == AttrText || info.d_name == AttrIdent )
+			d_changedSince++;
+		break;
+	case Udb::UpdateInfo::ObjectErased:
+		d_changedSince++;
+		break;
+	default:
+		break;
+	}
+}
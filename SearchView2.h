@@ -21,15 +21,23 @@
 */
 
 #include <QWidget>
+#include <QMap>
+#include <QDateTime>
+#include <QStringList>
+#include <QSet>
 #include <Udb/Obj.h>
+#include <Udb/UpdateInfo.h>
+#include <Fts/IndexEngine.h>
+#include "DocOrder.h"
 
 class QTreeWidget;
 class QLineEdit;
 class QCheckBox;
+class QTreeWidgetItem;
 
-namespace Fts
+namespace Udb
 {
-	class IndexEngine;
+	class Database;
 }
 namespace Oln
 {
@@ -39,12 +47,36 @@ namespace Oln
 	{
 		Q_OBJECT
 	public:
+		struct IndexStats
+		{
+			qint64 d_fileSize; // Bytes der .index Datei
+			quint32 d_terms; // Stand d_counted
+			quint32 d_postings; // Stand d_counted
+			quint32 d_docs; // Objekte mit Text, Stand d_counted
+			QStringList d_topTerms; // "term<TAB>count", absteigend
+			QDateTime d_counted; // letzte Zählung mit countTerms()
+			quint32 d_changedSince; // seit d_counted geänderte Objekte
+			QDateTime d_lastRebuild;
+			qint64 d_rebuildMs;
+			qint64 d_queryMs; // -1 falls in dieser Sitzung noch keine Abfrage
+			quint32 d_pending; // noch nicht in den Index übernommene Änderungen
+			int d_cachePages; // aktuelle Cache-Grösse der Index-Datenbank
+			IndexStats():d_fileSize(0),d_terms(0),d_postings(0),d_docs(0),d_changedSince(0),
+				d_rebuildMs(-1),d_queryMs(-1),d_pending(0),d_cachePages(0) {}
+			qreal avgPostingLen() const { return ( d_terms == 0 ) ? 0.0 : qreal( d_postings ) / qreal( d_terms ); }
+		};
+
 		explicit SearchView2(Outliner *parent = 0);
 		Udb::Obj getItem() const;
 		void newSearch() { doNew(); }
-		Fts::IndexEngine* getIdx() const { return d_idx; }
+		Fts::IndexEngine* getIdx() { ensureIndex(); return d_idx; }
+		bool ensureIndex(); // öffnet Index-Datenbank und IndexEngine beim ersten Gebrauch
+		bool compactIndex(); // baut die Index-Datei neu auf; false bei Abbruch oder Fehler
+		void saveState(); // vor dem Schliessen
 		static QStringList tokenize( const QString& );
 		static QString getIndexPath(Udb::Transaction* txn);
+		Udb::Obj findNext( const Udb::Obj& cur, bool forward = true ); // null wenn kein weiterer Treffer
+		IndexStats getStats() const;
 	signals:
 		void sigFollow( quint64 );
 	public slots:
@@ -54,21 +86,56 @@ namespace Oln
 		void onTest();
 		void onCloseAll();
 		void onOpenAll();
+		void onShowStats();
 	public slots:
 		void doSearch();
 		void doNew();
 		void doGoto();
+	protected slots:
+		void onFacet( QTreeWidgetItem* );
+		void onDbUpdate( Udb::UpdateInfo );
+		void onTxnUpdate( Udb::UpdateInfo );
+		void onBulkInserted( quint64 first, quint64 last );
 	protected:
+		struct Facets
+		{
+			QMap<QString,QPair<QString,int> > d_outlines; // key -> title, hits
+			QMap<QString,int> d_periods; // yyyy bzw. yyyy-MM -> hits
+			int d_titles;
+			int d_bodies;
+			Facets():d_titles(0),d_bodies(0) {}
+		};
 		bool rebuildIndex();
+		bool countTerms(); // false bei Abbruch
+		bool showStats(); // true, wenn neu gezählt werden soll
+		void closeIndex();
+		bool queryTokens( QStringList& );
+		QString statsKey() const;
+		quint32 getJournalCount() const;
+		void setCacheBudget( int mb ); // 0..Default aus Settings
+		void fillResult( SearchView2*, const Fts::IndexEngine::DocHits&, QTreeWidgetItem* repo, Facets& );
+		void fillFacets( const Facets& );
+		void applyFacet( int kind, const QString& key );
 	private:
 		QCheckBox* d_fullMatch;
 		QCheckBox* d_docAnd;
 		QCheckBox* d_itemAnd;
 		QCheckBox* d_curDoc;
+		QCheckBox* d_allRepos;
 		QLineEdit* d_query;
 		Outliner* d_oln;
 		QTreeWidget* d_result;
+		QTreeWidget* d_facets;
 		Fts::IndexEngine* d_idx;
+		Udb::Database* d_indexDb;
+		Udb::Transaction* d_indexTxn;
+		DocOrder d_order;
+		QMap<quint32,Udb::OID> d_hits; // Position in d_order -> Treffer
+		QString d_hitQuery;
+		Udb::Obj d_journal; // Änderungen bevor der Index geöffnet wurde, siehe s_journal
+		qint64 d_lastQueryMs;
+		quint32 d_changedSince; // Text-Änderungen seit der letzten Zählung der Terme
+		int d_cachePages;
 	};
 }
 
@@ -0,0 +1,113 @@
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "TitleCache.h"
+#include "TypeDefs.h"
+#include <Udb/ContentObject.h>
+#include <Udb/Database.h>
+#include <QHash>
+using namespace Oln;
+
+typedef QHash<Udb::Database*,TitleCache*> _Caches;
+static _Caches s_caches;
+
+TitleCache::TitleCache(Udb::Database* db, int maxEntries, QObject* p):QObject(p),d_db(db)
+{
+	d_cache.setMaxCost( qMax( 1, maxEntries ) );
+	s_caches[db] = this;
+}
+
+TitleCache::~TitleCache()
+{
+	s_caches.remove( d_db );
+}
+
+TitleCache* TitleCache::find(Udb::Database* db)
+{
+	return s_caches.value( db );
+}
+
+const TitleCache::Entry* TitleCache::get(const Udb::Obj& o)
+{
+	if( o.isNull() )
+		return 0;
+	Entry* e = d_cache.object( o.getOid() );
+	if( e )
+		return e;
+	Udb::Obj resolved = o.getValueAsObj( AttrItemAlias );
+	if( resolved.isNull() )
+		resolved = o;
+	e = new Entry();
+	e->d_resolved = resolved.getOid();
+	e->d_type = resolved.getType();
+	e->d_ident = resolved.getString( Udb::ContentObject::AttrIdent, true );
+	e->d_text = resolved.getString( Udb::ContentObject::AttrText, true );
+	if( e->d_resolved != o.getOid() && !d_byTarget.contains( e->d_resolved, o.getOid() ) )
+	{
+		if( d_byTarget.size() > 4 * d_cache.maxCost() )
+			prune();
+		d_byTarget.insert( e->d_resolved, o.getOid() );
+	}
+	d_cache.insert( o.getOid(), e ); // bleibt bis zum nächsten insert sicher drin, da Kosten 1
+	return e;
+}
+
+void TitleCache::prune()
+{
+	// Verdrängte Aliasse aus der Rückwärts-Tabelle entfernen
+	QMultiHash<Udb::OID,Udb::OID>::iterator i = d_byTarget.begin();
+	while( i != d_byTarget.end() )
+	{
+		if( d_cache.contains( i.value() ) )
+			++i;
+		else
+			i = d_byTarget.erase( i );
+	}
+}
+
+void TitleCache::clear()
+{
+	d_cache.clear();
+	d_byTarget.clear();
+}
+
+void TitleCache::remove(Udb::OID oid)
+{
+	d_cache.remove( oid );
+	foreach( Udb::OID alias, d_byTarget.values( oid ) )
+		d_cache.remove( alias );
+	d_byTarget.remove( oid );
+}
+
+void TitleCache::onDbUpdate(Udb::UpdateInfo info)
+{
+	switch( info.d_kind )
+	{
+	case Udb::UpdateInfo::ValueChanged:
+		if( info.d_name == AttrItemAlias || info.d_name == Udb::ContentObject::AttrText ||
+				info.d_name == Udb::ContentObject::AttrIdent )
+			remove( info.d_id );
+		break;
+	case Udb::UpdateInfo::ObjectErased:
+		remove( info.d_id );
+		break;
+	default:
+		break;
+	}
+}
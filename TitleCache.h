@@ -0,0 +1,64 @@
+#ifndef TITLECACHE_H
+#define TITLECACHE_H
+
+/*
+* Copyright 2010-2018 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the CrossLine application.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Udb/Obj.h>
+#include <Udb/UpdateInfo.h>
+#include <QCache>
+#include <QMultiHash>
+
+namespace Udb
+{
+	class Database;
+}
+
+namespace Oln
+{
+	// Beschränkter Cache der über AttrItemAlias aufgelösten Titel-Attribute, je Datenbank eine Instanz.
+	// Ein Eintrag wird verworfen, wenn sich Alias, Text oder Ident des Items oder seines Ziels ändern.
+	class TitleCache : public QObject
+	{
+		Q_OBJECT
+	public:
+		struct Entry
+		{
+			Udb::OID d_resolved; // Ziel des Alias oder das Item selber
+			quint32 d_type; // des Ziels
+			QString d_ident;
+			QString d_text;
+		};
+		TitleCache( Udb::Database*, int maxEntries, QObject* );
+		~TitleCache();
+		static TitleCache* find( Udb::Database* ); // 0 falls keiner angelegt
+		const Entry* get( const Udb::Obj& ); // nie 0 für !isNull; gültig bis zum nächsten get
+	public slots:
+		void clear();
+		void onDbUpdate( Udb::UpdateInfo );
+	private:
+		void remove( Udb::OID );
+		void prune();
+		Udb::Database* d_db;
+		QCache<Udb::OID,Entry> d_cache;
+		QMultiHash<Udb::OID,Udb::OID> d_byTarget; // Ziel -> gecachte Aliasse
+	};
+}
+
+#endif // TITLECACHE_H
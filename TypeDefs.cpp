@@ -22,11 +22,13 @@
 #include <Udb/Obj.h>
 #include <Oln2/OutlineItem.h>
 #include "DocTabWidget.h"
+#include "TitleCache.h"
 using namespace Oln;
 using namespace Udb;
 
 const char* IndexDefs::IdxStartDate = "IdxStartDate";
 const char* IndexDefs::IdxEndDate = "IdxEndDate";
+const char* IndexDefs::IdxArchivedFrom = "IdxArchivedFrom";
 
 void TypeDefs::init( Database& db )
 {
@@ -42,6 +44,12 @@ void TypeDefs::init( Database& db )
 		def.d_items.append( IndexMeta::Item( AttrItemAlias ) );
 		db.createIndex( OutlineItem::AliasIndex, def );
 	}
+	if( db.findIndex( IndexDefs::IdxArchivedFrom ) == 0 )
+	{
+		IndexMeta def( IndexMeta::Value );
+		def.d_items.append( IndexMeta::Item( AttrArchivedFrom ) );
+		db.createIndex( IndexDefs::IdxArchivedFrom, def );
+	}
 	/*
 	if( db.findIndex( IndexDefs::IdxStartDate ) == 0 )
 	{
@@ -91,14 +99,28 @@ QString TypeDefs::formatObjectTitle(const Obj &o, bool showId)
 {
 	if( o.isNull() )
 		return QLatin1String("<null>");
-	Udb::Obj resolvedObj = o.getValueAsObj( Oln::OutlineItem::AttrAlias );
-	if( resolvedObj.isNull() )
-		resolvedObj = o;
-	QString id = resolvedObj.getString( Udb::ContentObject::AttrIdent, true );
-	QString name = resolvedObj.getString( Udb::ContentObject::AttrText, true ).simplified();
+	QString id;
+	QString name;
+	quint32 type;
+	if( TitleCache* cache = TitleCache::find( o.getDb() ) )
+	{
+		// wird bei jedem Paint aufgerufen; Aliasse nicht jedes Mal auflösen
+		const TitleCache::Entry* e = cache->get( o );
+		id = e->d_ident;
+		name = e->d_text.simplified();
+		type = e->d_type;
+	}else
+	{
+		Udb::Obj resolvedObj = o.getValueAsObj( Oln::OutlineItem::AttrAlias );
+		if( resolvedObj.isNull() )
+			resolvedObj = o;
+		id = resolvedObj.getString( Udb::ContentObject::AttrIdent, true );
+		name = resolvedObj.getString( Udb::ContentObject::AttrText, true ).simplified();
+		type = resolvedObj.getType();
+	}
 	if( name.isEmpty() )
 	{
-		switch( resolvedObj.getType() )
+		switch( type )
 		{
 		case TypeOutlineItem:
 			name = QLatin1String("Outline Item");
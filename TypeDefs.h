@@ -21,6 +21,7 @@
 */
 
 #include <QString> 
+#include <QList>
 
 namespace Udb
 {
@@ -33,7 +34,7 @@ namespace Oln
 	enum OlnNumbers
 	{
 		OlnStart = 0x20000,
-		OlnMax = OlnStart + 27,
+		OlnMax = OlnStart + 30,
 		OlnEnd = OlnStart + 1000 // Ab hier werden dynamische Atome angelegt
 	};
 
@@ -41,6 +42,7 @@ namespace Oln
 	{
 		static const char* IdxStartDate; // AttrStartDate
 		static const char* IdxEndDate; // AttrEndDate
+		static const char* IdxArchivedFrom; // AttrArchivedFrom
 	};
 
 	enum TypeDef_Object // abstract
@@ -74,7 +76,15 @@ namespace Oln
 	{
 		AttrRootDockList = OlnStart + 24, // BML (OID...OID), Liste aller OutlineDocks
 		AttrRootTabList = OlnStart + 25, // BML (OID..OID), Liste aller geöffneten Tabs
-		AttrAutoOpen = OlnStart + 27   // OID: optionale Referenz auf ein Outline, das beim Start geöffnet wird
+		AttrAutoOpen = OlnStart + 27,   // OID: optionale Referenz auf ein Outline, das beim Start geöffnet wird
+		AttrRootArchive = OlnStart + 30 // String: Pfad des Archiv-Repository, falls Outlines ausgelagert wurden
+	};
+
+	// Ein ausgelagertes Outline bleibt als leerer Stub im Repository; Inhalt und Items liegen im Archiv
+	enum TypeDef_Archive
+	{
+		AttrArchivedAs = OlnStart + 28, // OID: beim Stub; das Outline im Archiv
+		AttrArchivedFrom = OlnStart + 29 // OID: im Archiv; ursprüngliche OID im Repository, für oid-Links
 	};
 
 	struct TypeDefs